@@ -0,0 +1,417 @@
+/*
+ * Copyright (C) 2015 - 2021 Gooroom <gooroom@gooroom.kr>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version. See http://www.gnu.org/copyleft/gpl.html the full text of the
+ * license.
+ */
+
+/* Background scaling micro-benchmark, built and run by "make bench".
+ * Checks first that every scaler kernel the CPU supports gives the same
+ * bytes, then times every scaling mode over a matrix of source and target
+ * sizes, from a decoded source ("memory") and from a JPEG file ("file").
+ * Prints one JSON object per line, so releases can be compared by scripts. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "greeterimage.h"
+
+static const gchar* const MODE_NAMES[] = { "source", "zoomed", "scaled", "stretched" };
+
+/* Device pixels */
+static const gint SOURCE_SIZES[][2] = {
+	{ 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 }, { 5120, 2880 }, { 7680, 4320 } };
+
+/* Logical pixels, rendered at every scale */
+static const gint TARGET_SIZES[][2] = {
+	{ 1280, 720 }, { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 } };
+
+static const gint TARGET_SCALES[] = { 1, 2 };
+
+/* Sources of the kernel check, widths are not multiples of any SIMD width */
+static const gint CHECK_SOURCE_SIZES[][2] = {
+	{ 1, 1 }, { 3, 2 }, { 7, 5 }, { 13, 31 }, { 37, 23 }, { 101, 67 }, { 333, 197 }, { 1283, 721 } };
+
+/* Target sizes of the kernel check, in 1/8 of the source size */
+static const gint CHECK_FACTORS[] = { 1, 3, 5, 8, 11, 21 };
+
+/* --quick skips sources above 4K */
+#define QUICK_SOURCE_PIXELS (3840 * 2160)
+
+static gint iterations = 3;
+static gchar* filter_name = NULL;
+static gboolean quick = FALSE;
+
+static GOptionEntry entries[] =
+{
+	{ "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations, "Runs of each case, the fastest one is reported (default: 3)", "N" },
+	{ "filter", 'f', 0, G_OPTION_ARG_STRING, &filter_name, "Resampling filter: area or bilinear (default: area)", "FILTER" },
+	{ "quick", 'q', 0, G_OPTION_ARG_NONE, &quick, "Sources up to 4K and one run per case", NULL },
+	{ NULL }
+};
+
+#ifdef __GLIBC__
+/* Every allocation of the process is counted, the scaler threads included */
+extern void* __libc_malloc (size_t size);
+extern void* __libc_calloc (size_t n, size_t size);
+extern void* __libc_realloc (void* ptr, size_t size);
+
+static volatile gint allocations = 0;
+
+void*
+malloc (size_t size)
+{
+	g_atomic_int_inc (&allocations);
+	return __libc_malloc (size);
+}
+
+void*
+calloc (size_t n, size_t size)
+{
+	g_atomic_int_inc (&allocations);
+	return __libc_calloc (n, size);
+}
+
+void*
+realloc (void* ptr, size_t size)
+{
+	g_atomic_int_inc (&allocations);
+	return __libc_realloc (ptr, size);
+}
+
+#define ALLOCATIONS() g_atomic_int_get (&allocations)
+#else
+#define ALLOCATIONS() (-1)
+#endif
+
+/* Starts a new peak RSS measure, Linux only */
+static void
+peak_rss_reset (void)
+{
+	FILE* file = fopen ("/proc/self/clear_refs", "w");
+
+	if (file) {
+		fputs ("5", file);
+		fclose (file);
+	}
+}
+
+/* Peak RSS since peak_rss_reset() in KiB, or of the whole process */
+static glong
+peak_rss (void)
+{
+	gchar line[256];
+	glong value = -1;
+	struct rusage usage;
+	FILE* file = fopen ("/proc/self/status", "r");
+
+	if (file) {
+		while (fgets (line, sizeof (line), file))
+			if (sscanf (line, "VmHWM: %ld kB", &value) == 1)
+				break;
+		fclose (file);
+	}
+
+	if (value < 0 && getrusage (RUSAGE_SELF, &usage) == 0)
+		value = usage.ru_maxrss;
+
+	return value;
+}
+
+/* Gradients with a texture, so JPEG files are not trivially small */
+static GdkPixbuf*
+source_new (gint width, gint height)
+{
+	gint x, y;
+	GdkPixbuf* pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, width, height);
+	gint rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+	guchar* pixels = gdk_pixbuf_get_pixels (pixbuf);
+
+	for (y = 0; y < height; ++y) {
+		guchar* p = pixels + (gsize) y * rowstride;
+
+		for (x = 0; x < width; ++x, p += 3) {
+			p[0] = x * 255 / width;
+			p[1] = y * 255 / height;
+			p[2] = (x ^ y) & 0xff;
+		}
+	}
+
+	return pixbuf;
+}
+
+static gchar*
+source_save (GdkPixbuf* source)
+{
+	gint fd;
+	gchar* path = NULL;
+	GError* error = NULL;
+
+	fd = g_file_open_tmp ("gooroom-greeter-bench-XXXXXX.jpg", &path, &error);
+	if (fd < 0) {
+		g_printerr ("%s\n", error->message);
+		g_clear_error (&error);
+		return NULL;
+	}
+	close (fd);
+
+	if (!gdk_pixbuf_save (source, path, "jpeg", &error, "quality", "90", NULL)) {
+		g_printerr ("%s\n", error->message);
+		g_clear_error (&error);
+		g_unlink (path);
+		g_clear_pointer (&path, g_free);
+	}
+
+	return path;
+}
+
+/* One run: load (file only), scale and convert to the surface the greeter keeps */
+static gboolean
+run_case (GdkPixbuf*   source,
+          const gchar* path,
+          ScalingMode  mode,
+          ScalerFilter filter,
+          gint         width,
+          gint         height,
+          gint         scale,
+          gint64*      duration,
+          gsize*       pixels)
+{
+	GdkPixbuf* input;
+	GdkPixbuf* pixbuf;
+	cairo_surface_t* image;
+	gint64 start_time = g_get_monotonic_time ();
+
+	input = path ? image_load_file (path, mode, width, height, NULL) : g_object_ref (source);
+	if (!input)
+		return FALSE;
+
+	pixbuf = image_scale (input, mode, width, height, filter);
+	g_object_unref (input);
+	if (!pixbuf)
+		return FALSE;
+
+	image = image_surface_from_pixbuf (pixbuf, scale);
+	*duration = g_get_monotonic_time () - start_time;
+	*pixels = (gsize) gdk_pixbuf_get_width (pixbuf) * gdk_pixbuf_get_height (pixbuf);
+
+	cairo_surface_destroy (image);
+	g_object_unref (pixbuf);
+
+	return TRUE;
+}
+
+static void
+bench_case (GdkPixbuf*   source,
+            const gchar* path,
+            ScalingMode  mode,
+            ScalerFilter filter,
+            gint         width,
+            gint         height,
+            gint         scale)
+{
+	gint i;
+	gint count = 0;
+	glong rss;
+	gsize pixels = 0;
+	gint64 best = G_MAXINT64;
+
+	for (i = 0; i < iterations; ++i) {
+		gint64 duration;
+
+		/* Memory use is reported for the last run, with warm caches */
+		peak_rss_reset ();
+		count = ALLOCATIONS ();
+
+		if (!run_case (source, path, mode, filter, width, height, scale, &duration, &pixels)) {
+			g_printerr ("Failed: %s %s %dx%d@%d\n", MODE_NAMES[mode], path ? path : "memory",
+                        width, height, scale);
+			return;
+		}
+
+		best = MIN (best, duration);
+		count = ALLOCATIONS () < 0 ? -1 : ALLOCATIONS () - count;
+	}
+	rss = peak_rss ();
+
+	g_print ("{\"input\": \"%s\", \"mode\": \"%s\", \"filter\": \"%s\", "
+             "\"source\": \"%dx%d\", \"target\": \"%dx%d\", \"scale\": %d, "
+             "\"ms\": %.3f, \"ns_per_pixel\": %.3f, \"peak_rss_kb\": %ld, \"allocations\": %d}\n",
+             path ? "file" : "memory", MODE_NAMES[mode],
+             filter == SCALER_FILTER_AREA ? "area" : "bilinear",
+             gdk_pixbuf_get_width (source), gdk_pixbuf_get_height (source),
+             width / scale, height / scale, scale,
+             best / 1000.0, pixels ? best * 1000.0 / pixels : 0.0, rss, count);
+}
+
+/* Noise, so every weight of every tap changes the result */
+static GdkPixbuf*
+check_source_new (gint width, gint height, gboolean has_alpha, GRand* rand)
+{
+	gint x, y;
+	GdkPixbuf* pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, has_alpha, 8, width, height);
+	gint rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+	gint length = width * gdk_pixbuf_get_n_channels (pixbuf);
+	guchar* pixels = gdk_pixbuf_get_pixels (pixbuf);
+
+	for (y = 0; y < height; ++y)
+		for (x = 0; x < length; ++x)
+			pixels[(gsize) y * rowstride + x] = g_rand_int_range (rand, 0, 256);
+
+	return pixbuf;
+}
+
+/* Row and column of the first different byte, FALSE if there is none */
+static gboolean
+check_compare (GdkPixbuf* expected, GdkPixbuf* pixbuf, gint* row, gint* column)
+{
+	gint y;
+	gint height = gdk_pixbuf_get_height (expected);
+	gint length = gdk_pixbuf_get_width (expected) * gdk_pixbuf_get_n_channels (expected);
+
+	for (y = 0; y < height; ++y) {
+		const guchar* a = gdk_pixbuf_get_pixels (expected) + (gsize) y * gdk_pixbuf_get_rowstride (expected);
+		const guchar* b = gdk_pixbuf_get_pixels (pixbuf) + (gsize) y * gdk_pixbuf_get_rowstride (pixbuf);
+
+		if (memcmp (a, b, length) != 0) {
+			*row = y;
+			for (*column = 0; a[*column] == b[*column]; ++*column);
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/* Every kernel the CPU supports gives the bytes of the scalar one, shrinking and enlarging */
+static gboolean
+check_kernels (void)
+{
+	guint s, w, h;
+	gint alpha;
+	gint cases = 0;
+	gboolean ok = TRUE;
+	ScalerKernel kernel;
+	ScalerKernel best = scaler_detect_kernel ();
+	GRand* rand = g_rand_new_with_seed (1);
+
+	for (s = 0; s < G_N_ELEMENTS (CHECK_SOURCE_SIZES); ++s) {
+		for (alpha = 0; alpha < 2; ++alpha) {
+			gint src_width = CHECK_SOURCE_SIZES[s][0];
+			gint src_height = CHECK_SOURCE_SIZES[s][1];
+			GdkPixbuf* source = check_source_new (src_width, src_height, alpha, rand);
+
+			for (w = 0; w < G_N_ELEMENTS (CHECK_FACTORS); ++w) {
+				for (h = 0; h < G_N_ELEMENTS (CHECK_FACTORS); ++h) {
+					gint width = MAX (1, src_width * CHECK_FACTORS[w] / 8);
+					gint height = MAX (1, src_height * CHECK_FACTORS[h] / 8);
+					GdkPixbuf* expected = scaler_scale_pixbuf (source, width, height,
+                                                               SCALER_FILTER_AREA, SCALER_KERNEL_SCALAR);
+
+					for (kernel = SCALER_KERNEL_SCALAR + 1; kernel <= best; ++kernel) {
+						gint row, column;
+						GdkPixbuf* pixbuf = scaler_scale_pixbuf (source, width, height,
+                                                                 SCALER_FILTER_AREA, kernel);
+
+						if (check_compare (expected, pixbuf, &row, &column)) {
+							g_printerr ("Kernel %s differs from scalar: %dx%d%s to %dx%d, row %d, byte %d\n",
+                                        scaler_kernel_to_string (kernel), src_width, src_height,
+                                        alpha ? " (alpha)" : "", width, height, row, column);
+							ok = FALSE;
+						}
+						g_object_unref (pixbuf);
+						++cases;
+					}
+					g_object_unref (expected);
+				}
+			}
+			g_object_unref (source);
+		}
+	}
+	g_rand_free (rand);
+
+	g_print ("{\"check\": \"kernels\", \"best\": \"%s\", \"cases\": %d, \"ok\": %s}\n",
+             scaler_kernel_to_string (best), cases, ok ? "true" : "false");
+
+	return ok;
+}
+
+int
+main (int argc, char **argv)
+{
+	guint s, t, i, m;
+	ScalerFilter filter = SCALER_FILTER_AREA;
+	GError* error = NULL;
+	GOptionContext* context;
+
+	context = g_option_context_new ("- gooroom-greeter background scaling benchmark");
+	g_option_context_add_main_entries (context, entries, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_clear_error (&error);
+		g_option_context_free (context);
+		return EXIT_FAILURE;
+	}
+	g_option_context_free (context);
+
+	if (filter_name && !scaler_filter_from_string (filter_name, &filter)) {
+		g_printerr ("Unknown filter: %s\n", filter_name);
+		return EXIT_FAILURE;
+	}
+
+	if (quick)
+		iterations = 1;
+	iterations = MAX (1, iterations);
+
+	g_print ("{\"bench\": \"%s\", \"version\": \"%s\", \"iterations\": %d, \"processors\": %u}\n",
+             PACKAGE, VERSION, iterations, g_get_num_processors ());
+
+	if (!check_kernels ())
+		return EXIT_FAILURE;
+
+	for (s = 0; s < G_N_ELEMENTS (SOURCE_SIZES); ++s) {
+		GdkPixbuf* source;
+		gchar* path;
+
+		if (quick && SOURCE_SIZES[s][0] * SOURCE_SIZES[s][1] > QUICK_SOURCE_PIXELS)
+			continue;
+
+		source = source_new (SOURCE_SIZES[s][0], SOURCE_SIZES[s][1]);
+		path = source_save (source);
+
+		for (m = 0; m < G_N_ELEMENTS (MODE_NAMES); ++m) {
+			for (t = 0; t < G_N_ELEMENTS (TARGET_SIZES); ++t) {
+				for (i = 0; i < G_N_ELEMENTS (TARGET_SCALES); ++i) {
+					gint scale = TARGET_SCALES[i];
+					gint width = TARGET_SIZES[t][0] * scale;
+					gint height = TARGET_SIZES[t][1] * scale;
+
+					bench_case (source, NULL, m, filter, width, height, scale);
+					if (path)
+						bench_case (source, path, m, filter, width, height, scale);
+				}
+			}
+		}
+
+		if (path)
+			g_unlink (path);
+		g_free (path);
+		g_object_unref (source);
+	}
+
+	g_free (filter_name);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2015 - 2021 Gooroom <gooroom@gooroom.kr>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version. See http://www.gnu.org/copyleft/gpl.html the full text of the
+ * license.
+ */
+
+/* Pre-renders the configured background for common screen sizes into the
+ * prebuilt cache, so the greeter only maps ready images on first boot.
+ * Runs without a display, e.g. from the package postinst. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <glib.h>
+
+#include "greeterbackgroundcache.h"
+#include "greeterconfiguration.h"
+#include "greeterimage.h"
+
+/* Device pixels of common monitors, each one is rendered for every scale it divides */
+static const gchar* const DEFAULT_RESOLUTIONS[] = {
+	"1024x768", "1280x800", "1280x1024", "1366x768", "1440x900", "1600x900",
+	"1680x1050", "1920x1080", "1920x1200", "2560x1080", "2560x1440", "2560x1600",
+	"3440x1440", "3840x2160", NULL };
+
+static const gint DEFAULT_SCALES[] = { 1, 2 };
+
+static gchar** resolutions = NULL;
+static gchar* output_dir = NULL;
+static gboolean verbose = FALSE;
+
+static GOptionEntry entries[] =
+{
+	{ "resolution", 'r', 0, G_OPTION_ARG_STRING_ARRAY, &resolutions,
+	  "Render for this size in device pixels (repeatable)", "WIDTHxHEIGHT" },
+	{ "output", 'o', 0, G_OPTION_ARG_FILENAME, &output_dir,
+	  "Directory of the prebuilt cache (default: " BACKGROUND_PREBUILT_DIR ")", "DIR" },
+	{ "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose, "Print each rendered image", NULL },
+	{ NULL }
+};
+
+static gboolean
+render (const gchar* path,
+        ScalingMode  mode,
+        ScalerFilter filter,
+        gint         width,
+        gint         height,
+        gint         scale,
+        GHashTable*  sources)
+{
+	GdkPixbuf* source;
+	GdkPixbuf* pixbuf;
+	cairo_surface_t* image;
+	cairo_surface_t* stored;
+
+	source = image_load_file (path, mode, width, height, sources);
+	if (!source)
+		return FALSE;
+
+	pixbuf = image_scale (source, mode, width, height, filter);
+	g_object_unref (source);
+	if (!pixbuf)
+		return FALSE;
+
+	image = image_surface_from_pixbuf (pixbuf, scale);
+	g_object_unref (pixbuf);
+
+	stored = background_cache_store (path, mode, filter, width, height, scale, image);
+	cairo_surface_destroy (image);
+
+	if (!stored)
+		return FALSE;
+	cairo_surface_destroy (stored);
+
+	if (verbose)
+		g_print ("%s: %dx%d@%d\n", path, width, height, scale);
+
+	return TRUE;
+}
+
+/* All sizes of one image, returns the number of rendered ones */
+static guint
+render_sizes (const gchar*        path,
+              ScalingMode         mode,
+              ScalerFilter        filter,
+              const gchar* const* sizes)
+{
+	guint i, j;
+	guint count = 0;
+	/* Source is decoded once per JPEG scale denominator */
+	GHashTable* sources = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+
+	for (i = 0; sizes[i]; ++i) {
+		const gchar* size = sizes[i];
+		gint width, height;
+
+		if (sscanf (size, "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+			g_printerr ("Invalid resolution: %s\n", size);
+			continue;
+		}
+
+		for (j = 0; j < G_N_ELEMENTS (DEFAULT_SCALES); ++j) {
+			gint scale = DEFAULT_SCALES[j];
+
+			/* Logical monitor size must be whole */
+			if (width % scale != 0 || height % scale != 0)
+				continue;
+
+			if (!render (path, mode, filter, width, height, scale, sources)) {
+				g_printerr ("Failed to render %s for %dx%d@%d\n", path, width, height, scale);
+				continue;
+			}
+			count++;
+		}
+	}
+
+	g_hash_table_unref (sources);
+
+	return count;
+}
+
+/* Every slide of a background= value, solid colors need nothing */
+static guint
+render_background (const gchar*        value,
+                   const ScalerFilter* filters,
+                   const gchar* const* sizes)
+{
+	guint count = 0;
+	gchar** slides;
+	const gchar* path;
+	ScalingMode mode;
+
+	path = value ? image_parse_scaling_mode (value, &mode) : NULL;
+	if (!path || !g_path_is_absolute (path))
+		return 0;
+
+	slides = image_list_slides (path);
+	if (slides) {
+		gchar** slide;
+
+		for (slide = slides; *slide; ++slide)
+			count += render_sizes (*slide, mode, filters[mode], sizes);
+		g_strfreev (slides);
+	} else if (g_file_test (path, G_FILE_TEST_IS_REGULAR)) {
+		count = render_sizes (path, mode, filters[mode], sizes);
+	}
+
+	return count;
+}
+
+int
+main (int argc, char **argv)
+{
+	guint count = 0;
+	gchar* value;
+	gchar* filter;
+	gchar** groups;
+	gchar** group;
+	GError* error = NULL;
+	GOptionContext* context;
+	const gchar* const* sizes;
+	ScalerFilter filters[SCALING_MODE_COUNT];
+
+	context = g_option_context_new ("- pre-render gooroom-greeter backgrounds");
+	g_option_context_add_main_entries (context, entries, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_clear_error (&error);
+		g_option_context_free (context);
+		return EXIT_FAILURE;
+	}
+	g_option_context_free (context);
+
+	config_init_files ();
+
+	/* Variants of an older wallpaper are useless now */
+	background_cache_init (output_dir ? output_dir : BACKGROUND_PREBUILT_DIR, NULL, BACKGROUND_CACHE_UNLIMITED);
+	background_cache_clear ();
+
+	filter = config_get_string (CONFIG_GROUP_DEFAULT, CONFIG_KEY_BACKGROUND_FILTER, NULL);
+	image_parse_scaling_filters (filter, filters);
+	g_free (filter);
+
+	sizes = resolutions ? (const gchar* const*) resolutions : DEFAULT_RESOLUTIONS;
+
+	value = config_get_string (CONFIG_GROUP_DEFAULT, CONFIG_KEY_BACKGROUND, NULL);
+	count += render_background (value, filters, sizes);
+	g_free (value);
+
+	/* [monitor: NAME] sections */
+	groups = config_get_groups (CONFIG_GROUP_MONITOR);
+	for (group = groups; group && *group; ++group) {
+		value = config_get_string (*group, CONFIG_KEY_BACKGROUND, NULL);
+		count += render_background (value, filters, sizes);
+		g_free (value);
+	}
+	g_strfreev (groups);
+
+	if (verbose)
+		g_print ("%u images rendered\n", count);
+
+	g_strfreev (resolutions);
+	g_free (output_dir);
+
+	/* Failures are reported above, the greeter scales missing sizes itself */
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) 2015 - 2021 Gooroom <gooroom@gooroom.kr>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version. See http://www.gnu.org/copyleft/gpl.html the full text of the
+ * license.
+ */
+
+/* Monitor hotplug handling without a display, run by "make check".
+ * A burst of "monitors-changed" must be reconciled once, and reconciling
+ * a layout that did not change must not create or destroy any window.
+ * Prints one JSON object per check, like gooroom-greeter-bench. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <glib.h>
+
+#include "greeterlayout.h"
+
+/* Short enough for a quick check, long enough for events 2 ms apart */
+#define DEBOUNCE_DELAY      100
+#define EVENT_INTERVAL      2
+#define STORM_EVENTS        50
+
+/* Laptop panel, docking station monitors, then a projector mirroring the panel */
+static const LayoutMonitor LAPTOP[] = {
+	{ "LP140WF1", { 0, 0, 1920, 1080 }, 1, FALSE } };
+static const LayoutMonitor DOCKED[] = {
+	{ "LP140WF1", { 0, 0, 1920, 1080 }, 1, FALSE },
+	{ "DELL U2720Q", { 1920, 0, 3840, 2160 }, 2, FALSE },
+	{ "DELL U2720Q", { 5760, 0, 3840, 2160 }, 2, FALSE } };
+static const LayoutMonitor DOCKED_ROTATED[] = {
+	{ "LP140WF1", { 0, 0, 1920, 1080 }, 1, FALSE },
+	{ "DELL U2720Q", { 1920, 0, 2160, 3840 }, 2, FALSE },
+	{ "DELL U2720Q", { 4080, 0, 3840, 2160 }, 2, FALSE } };
+static const LayoutMonitor MIRRORED[] = {
+	{ "LP140WF1", { 0, 0, 1920, 1080 }, 1, FALSE },
+	{ NULL, { 0, 0, 1920, 1080 }, 1, FALSE } };
+
+typedef struct
+{
+	const LayoutMonitor* monitors;
+	gsize monitors_size;
+} Layout;
+
+#define LAYOUT(monitors) { monitors, G_N_ELEMENTS (monitors) }
+
+/* Reconciled layout, and what reconciling it changed so far */
+typedef struct
+{
+	GMainLoop* loop;
+	LayoutDebounce debounce;
+	Layout shown;
+	Layout current;
+	guint reconciles;
+	guint events;
+	gint created;
+	gint removed;
+	/* Storm: layouts announced one event after the other */
+	const Layout* storm;
+	guint storm_size;
+	guint storm_index;
+} HotplugScreen;
+
+static gboolean ok = TRUE;
+
+static void
+check (gboolean condition, const gchar* name, const gchar* what)
+{
+	if (!condition) {
+		g_printerr ("%s: %s\n", name, what);
+		ok = FALSE;
+	}
+}
+
+static gboolean
+quit_cb (gpointer user_data)
+{
+	g_main_loop_quit (user_data);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Skipped monitors are found as the greeter does, on copies */
+static LayoutMonitor*
+layout_copy (const Layout* layout)
+{
+	gsize i;
+	LayoutMonitor* monitors = g_new (LayoutMonitor, layout->monitors_size);
+
+	for (i = 0; i < layout->monitors_size; ++i)
+		monitors[i] = layout->monitors[i];
+
+	return monitors;
+}
+
+static LayoutDiff*
+diff_layouts (const Layout* old_layout, const Layout* layout)
+{
+	LayoutMonitor* old_monitors = layout_copy (old_layout);
+	LayoutMonitor* monitors = layout_copy (layout);
+	LayoutDiff* diff;
+
+	layout_mark_skipped (old_monitors, old_layout->monitors_size);
+	layout_mark_skipped (monitors, layout->monitors_size);
+	diff = layout_diff (old_monitors, old_layout->monitors_size, monitors, layout->monitors_size);
+
+	g_free (old_monitors);
+	g_free (monitors);
+
+	return diff;
+}
+
+static void
+check_diff (const gchar* name,
+            const Layout old_layout,
+            const Layout layout,
+            gint kept,
+            gint moved,
+            gint created,
+            gint removed)
+{
+	LayoutDiff* diff = diff_layouts (&old_layout, &layout);
+
+	check (diff->kept == kept, name, "kept");
+	check (diff->moved == moved, name, "moved");
+	check (diff->created == created, name, "created");
+	check (diff->removed_count == removed, name, "removed");
+
+	g_print ("{\"check\": \"diff\", \"case\": \"%s\", \"kept\": %d, \"moved\": %d, \"created\": %d, \"removed\": %d}\n",
+             name, diff->kept, diff->moved, diff->created, diff->removed_count);
+
+	layout_diff_free (diff);
+}
+
+static void
+screen_reconcile_cb (guint events, gpointer user_data)
+{
+	HotplugScreen* screen = user_data;
+	LayoutDiff* diff = diff_layouts (&screen->shown, &screen->current);
+
+	screen->reconciles++;
+	screen->events += events;
+	screen->created += diff->created;
+	screen->removed += diff->removed_count;
+	screen->shown = screen->current;
+
+	layout_diff_free (diff);
+}
+
+/* One "monitors-changed" for each layout of the storm, then the loop ends
+ * once the debounce delay is well over */
+static gboolean
+screen_storm_cb (gpointer user_data)
+{
+	HotplugScreen* screen = user_data;
+
+	if (screen->storm_index < screen->storm_size) {
+		screen->current = screen->storm[screen->storm_index++];
+		layout_debounce_event (&screen->debounce);
+		return G_SOURCE_CONTINUE;
+	}
+
+	g_timeout_add (DEBOUNCE_DELAY * 3, quit_cb, screen->loop);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+run_storm (HotplugScreen* screen, const Layout* storm, guint storm_size)
+{
+	screen->storm = storm;
+	screen->storm_size = storm_size;
+	screen->storm_index = 0;
+
+	g_timeout_add (EVENT_INTERVAL, screen_storm_cb, screen);
+	g_main_loop_run (screen->loop);
+}
+
+static void
+check_storm (const gchar* name, const Layout* storm, guint storm_size, gint created, gint removed)
+{
+	HotplugScreen screen = { NULL };
+	Layout laptop = LAYOUT (LAPTOP);
+
+	screen.loop = g_main_loop_new (NULL, FALSE);
+	screen.shown = laptop;
+	screen.current = laptop;
+	layout_debounce_init (&screen.debounce, DEBOUNCE_DELAY, screen_reconcile_cb, &screen);
+
+	run_storm (&screen, storm, storm_size);
+
+	check (screen.reconciles == 1, name, "one reconcile for the whole burst");
+	check (screen.events == storm_size, name, "every event counted");
+	check (screen.created == created, name, "created");
+	check (screen.removed == removed, name, "removed");
+
+	g_print ("{\"check\": \"storm\", \"case\": \"%s\", \"events\": %u, \"reconciles\": %u, \"created\": %d, \"removed\": %d}\n",
+             name, storm_size, screen.reconciles, screen.created, screen.removed);
+
+	layout_debounce_cancel (&screen.debounce);
+	g_main_loop_unref (screen.loop);
+}
+
+/* Events followed by a cancel, as on disconnect, are never reconciled */
+static void
+check_cancel (void)
+{
+	HotplugScreen screen = { NULL };
+	Layout laptop = LAYOUT (LAPTOP);
+
+	screen.loop = g_main_loop_new (NULL, FALSE);
+	screen.shown = laptop;
+	screen.current = laptop;
+	layout_debounce_init (&screen.debounce, DEBOUNCE_DELAY, screen_reconcile_cb, &screen);
+
+	layout_debounce_event (&screen.debounce);
+	layout_debounce_event (&screen.debounce);
+	layout_debounce_cancel (&screen.debounce);
+
+	g_timeout_add (DEBOUNCE_DELAY * 3, quit_cb, screen.loop);
+	g_main_loop_run (screen.loop);
+
+	check (screen.reconciles == 0, "cancel", "no reconcile after cancel");
+
+	g_print ("{\"check\": \"cancel\", \"reconciles\": %u}\n", screen.reconciles);
+
+	g_main_loop_unref (screen.loop);
+}
+
+int
+main (int argc, char **argv)
+{
+	guint i;
+	Layout laptop = LAYOUT (LAPTOP);
+	Layout docked = LAYOUT (DOCKED);
+	Layout rotated = LAYOUT (DOCKED_ROTATED);
+	Layout mirrored = LAYOUT (MIRRORED);
+	Layout flapping[STORM_EVENTS];
+	Layout docking[STORM_EVENTS];
+
+	check_diff ("unchanged", laptop, laptop, 1, 0, 0, 0);
+	check_diff ("unchanged-docked", docked, docked, 3, 0, 0, 0);
+	check_diff ("dock", laptop, docked, 1, 0, 2, 0);
+	check_diff ("undock", docked, laptop, 1, 0, 0, 2);
+	check_diff ("rotate", docked, rotated, 1, 2, 0, 0);
+	check_diff ("mirror", laptop, mirrored, 1, 0, 0, 0);
+	check_diff ("unmirror", mirrored, laptop, 1, 0, 0, 0);
+
+	/* A docking station bringing its outputs up one by one, and a flaky
+	 * cable ending where it started */
+	for (i = 0; i < STORM_EVENTS; ++i) {
+		docking[i] = i + 1 < STORM_EVENTS ? (i % 2 ? laptop : rotated) : docked;
+		flapping[i] = i % 2 ? laptop : docked;
+	}
+
+	check_storm ("docking", docking, STORM_EVENTS, 2, 0);
+	check_storm ("flapping", flapping, STORM_EVENTS, 0, 0);
+	check_cancel ();
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2015 - 2021 Gooroom <gooroom@gooroom.kr>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version. See http://www.gnu.org/copyleft/gpl.html the full text of the
+ * license.
+ */
+
+/* PAM message classifier micro-benchmark, built and run by "make bench".
+ * Checks the rules against a corpus of messages first, then times them
+ * against the if/else chain process_prompts() used before the rules table.
+ * Prints one JSON object per line, like gooroom-greeter-bench. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gi18n.h>
+
+#include "greeterpammessage.h"
+
+static gint iterations = 20000;
+static gboolean quick = FALSE;
+
+static GOptionEntry entries[] =
+{
+	{ "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations, "Passes over the corpus (default: 20000)", "N" },
+	{ "quick", 'q', 0, G_OPTION_ARG_NONE, &quick, "Check the corpus and time 1000 passes", NULL },
+	{ NULL }
+};
+
+/* Tags and messages of the corpus, in file order */
+typedef struct
+{
+	GPtrArray* expected;
+	GPtrArray* messages;
+} Corpus;
+
+static gboolean
+corpus_load (Corpus* corpus, const gchar* path)
+{
+	gchar* data;
+	gchar** lines;
+	gchar** line;
+	GError* error = NULL;
+
+	if (!g_file_get_contents (path, &data, NULL, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_clear_error (&error);
+		return FALSE;
+	}
+
+	corpus->expected = g_ptr_array_new_with_free_func (g_free);
+	corpus->messages = g_ptr_array_new_with_free_func (g_free);
+
+	lines = g_strsplit (data, "\n", -1);
+	for (line = lines; *line; ++line) {
+		gchar* tab = strchr (*line, '\t');
+
+		if (**line == '#' || !tab)
+			continue;
+
+		g_ptr_array_add (corpus->expected, g_strndup (*line, tab - *line));
+		g_ptr_array_add (corpus->messages, g_strdup (tab + 1));
+	}
+	g_strfreev (lines);
+	g_free (data);
+
+	return corpus->messages->len > 0;
+}
+
+/* Every message gets the expected rule, and formatting it does not fail */
+static gboolean
+corpus_check (Corpus* corpus)
+{
+	guint i;
+	gboolean ok = TRUE;
+
+	for (i = 0; i < corpus->messages->len; ++i) {
+		gchar** fields;
+		const gchar* message = g_ptr_array_index (corpus->messages, i);
+		const gchar* expected = g_ptr_array_index (corpus->expected, i);
+		const PamMessageRule* rule = pam_message_classify (message, &fields);
+
+		if (g_strcmp0 (rule ? rule->tag : "-", expected) != 0) {
+			g_printerr ("\"%s\": expected %s, got %s\n", message, expected, rule ? rule->tag : "-");
+			ok = FALSE;
+		}
+
+		if (rule)
+			g_free (pam_message_format (rule, message, fields));
+		g_strfreev (fields);
+	}
+
+	return ok;
+}
+
+/* process_prompts() before the rules table: translations are looked up and
+ * the prefixes compared in order for every message */
+static gboolean
+legacy_classify (const gchar* text)
+{
+	guint i;
+	gchar** tokens = NULL;
+	const gchar* required[] = {
+		"You are required to change your password immediately",
+		g_dgettext ("Linux-PAM", "You are required to change your password immediately (administrator enforced)"),
+		g_dgettext ("Linux-PAM", "You are required to change your password immediately (password expired)") };
+	const gchar* warnings[] = {
+		"Temporary Password", "Password Maxday Warning", "Account Expiration Warning",
+		"Division Expiration Warning", "Password Expiration Warning" };
+	const gchar* expire = _("your password will expire in");
+	const gchar* others[] = {
+		"Duplicate Login Notification", "Authentication Failure", "Deleted Account", "Invalid Account",
+		"No Exist Account", "Policy Violation Account", "Not Allowed IP", "Account Locking",
+		"Account Expiration", "Password Expiration", "Duplicate Login", "Division Expiration",
+		"Login Trial Exceed", "Trial Period Expired", "DateTime Error", "Trial Period Warning" };
+
+	for (i = 0; i < G_N_ELEMENTS (required); ++i)
+		if (strstr (text, required[i]))
+			return TRUE;
+
+	for (i = 0; i < G_N_ELEMENTS (warnings); ++i) {
+		if (g_str_has_prefix (text, warnings[i])) {
+			/* Each branch with fields split the message itself */
+			if (i > 0)
+				tokens = g_strsplit (text, ":", -1);
+			g_strfreev (tokens);
+			return TRUE;
+		}
+	}
+
+	if (strstr (text, expire))
+		return TRUE;
+
+	for (i = 0; i < G_N_ELEMENTS (others); ++i) {
+		if (g_str_has_prefix (text, others[i])) {
+			if (i < 2 || i == G_N_ELEMENTS (others) - 1)
+				tokens = g_strsplit (text, ":", -1);
+			g_strfreev (tokens);
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static void
+bench_rules (Corpus* corpus)
+{
+	gint n;
+	guint i;
+	gint64 duration;
+	gint64 start_time = g_get_monotonic_time ();
+
+	for (n = 0; n < iterations; ++n) {
+		for (i = 0; i < corpus->messages->len; ++i) {
+			gchar** fields;
+
+			pam_message_classify (g_ptr_array_index (corpus->messages, i), &fields);
+			g_strfreev (fields);
+		}
+	}
+	duration = g_get_monotonic_time () - start_time;
+
+	g_print ("{\"classifier\": \"rules\", \"ms\": %.3f, \"ns_per_message\": %.1f}\n",
+             duration / 1000.0, duration * 1000.0 / ((gdouble) iterations * corpus->messages->len));
+}
+
+static void
+bench_legacy (Corpus* corpus)
+{
+	gint n;
+	guint i;
+	gint64 duration;
+	gint64 start_time = g_get_monotonic_time ();
+
+	for (n = 0; n < iterations; ++n)
+		for (i = 0; i < corpus->messages->len; ++i)
+			legacy_classify (g_ptr_array_index (corpus->messages, i));
+	duration = g_get_monotonic_time () - start_time;
+
+	g_print ("{\"classifier\": \"legacy\", \"ms\": %.3f, \"ns_per_message\": %.1f}\n",
+             duration / 1000.0, duration * 1000.0 / ((gdouble) iterations * corpus->messages->len));
+}
+
+int
+main (int argc, char **argv)
+{
+	gint64 start_time;
+	Corpus corpus;
+	GError* error = NULL;
+	GOptionContext* context;
+
+	context = g_option_context_new ("CORPUS - gooroom-greeter PAM message classifier benchmark");
+	g_option_context_add_main_entries (context, entries, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_clear_error (&error);
+		g_option_context_free (context);
+		return EXIT_FAILURE;
+	}
+	g_option_context_free (context);
+
+	if (argc != 2) {
+		g_printerr ("Usage: %s [OPTION...] CORPUS\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (!corpus_load (&corpus, argv[1])) {
+		g_printerr ("No messages in %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	if (quick)
+		iterations = 1000;
+	iterations = MAX (1, iterations);
+
+	/* Expected tags are untranslated */
+	pam_message_rules_init (NULL);
+	if (!corpus_check (&corpus))
+		return EXIT_FAILURE;
+
+	/* Timed with the translations of the user locale, as in the greeter */
+	setlocale (LC_ALL, "");
+	bindtextdomain (GETTEXT_PACKAGE, LOCALEDIR);
+	bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
+	textdomain (GETTEXT_PACKAGE);
+
+	start_time = g_get_monotonic_time ();
+	pam_message_rules_init (NULL);
+
+	g_print ("{\"bench\": \"%s-pam\", \"version\": \"%s\", \"messages\": %u, \"iterations\": %d, "
+             "\"locale\": \"%s\", \"init_ms\": %.3f}\n",
+             PACKAGE, VERSION, corpus.messages->len, iterations, setlocale (LC_MESSAGES, NULL),
+             (g_get_monotonic_time () - start_time) / 1000.0);
+
+	bench_rules (&corpus);
+	bench_legacy (&corpus);
+
+	pam_message_rules_clear ();
+	g_ptr_array_unref (corpus.expected);
+	g_ptr_array_unref (corpus.messages);
+
+	return EXIT_SUCCESS;
+}
@@ -30,49 +30,14 @@
 
 #include "greeter-window.h"
 #include "greeterbackground.h"
+#include "greeterbackgroundcache.h"
 #include "greeterconfiguration.h"
+#include "greeterpammessage.h"
 
 
 static GtkWidget *greeter_window = NULL;
 static GreeterBackground *greeter_background = NULL;
-
-struct SavedFocusData
-{
-	GtkWidget *widget;
-	gint editable_pos;
-};
-
-gpointer greeter_save_focus    (GtkWidget* widget);
-void     greeter_restore_focus (const gpointer saved_data);
-
-
-
-void
-greeter_restore_focus (const gpointer saved_data)
-{
-	struct SavedFocusData *data = saved_data;
-
-	if (!saved_data || !GTK_IS_WIDGET (data->widget))
-		return;
-
-	gtk_widget_grab_focus (data->widget);
-	if (GTK_IS_EDITABLE(data->widget) && data->editable_pos > -1)
-		gtk_editable_set_position(GTK_EDITABLE(data->widget), data->editable_pos);
-}
-
-gpointer
-greeter_save_focus (GtkWidget* widget)
-{
-	GtkWidget *window = gtk_widget_get_toplevel(widget);
-	if (!GTK_IS_WINDOW (window))
-	return NULL;
-
-	struct SavedFocusData *data = g_new0 (struct SavedFocusData, 1);
-	data->widget = gtk_window_get_focus (GTK_WINDOW (window));
-	data->editable_pos = GTK_IS_EDITABLE(data->widget) ? gtk_editable_get_position (GTK_EDITABLE (data->widget)) : -1;
-
-	return data;
-}
+static guint switch_indicator_update_id = 0;
 
 static void
 sigterm_cb (gpointer user_data)
@@ -333,18 +298,23 @@ active_monitor_changed_idle_cb (gpointer user_data)
 		cairo_region_union_rectangle (region, &geometry);
 		real_monitor_num++;
 	}
+	cairo_region_destroy (region);
 
 	if (greeter_window)
 		greeter_window_set_switch_indicator_visible (GREETER_WINDOW (greeter_window),
                                                      real_monitor_num > 1);
 
+	switch_indicator_update_id = 0;
+
 	return FALSE;
 }
 
 static void
 active_monitor_changed_cb (GreeterBackground *background, gpointer user_data)
 {
-	g_timeout_add (300, (GSourceFunc) active_monitor_changed_idle_cb, NULL);
+	/* Background already waits for the monitor layout to settle */
+	if (!switch_indicator_update_id)
+		switch_indicator_update_id = g_idle_add ((GSourceFunc) active_monitor_changed_idle_cb, NULL);
 }
 
 static void
@@ -356,6 +326,15 @@ greeter_window_active_monitor_changed_cb (GreeterWindow *window,
 		greeter_background_set_active_monitor_from_geometry (greeter_background, geometry);
 }
 
+static void
+greeter_window_session_starting_cb (GreeterWindow *window,
+                                    gpointer       user_data)
+{
+	/* Session starts on the greeter background instead of a black root window */
+	if (greeter_background)
+		greeter_background_save_xroot (greeter_background);
+}
+
 
 int
 main (int argc, char **argv)
@@ -363,6 +342,15 @@ main (int argc, char **argv)
 	int ret = EXIT_SUCCESS;
 	GdkScreen *screen = NULL;
 	gchar *background = NULL;
+	gchar *placeholder = NULL;
+	gchar *cache_dir = NULL;
+	gchar *shared_cache_dir = NULL;
+	gchar *shared_cache = NULL;
+	gchar *filter = NULL;
+	gchar *backdrop = NULL;
+	gchar *pam_messages = NULL;
+	gchar **monitors = NULL;
+	gchar **group = NULL;
 //	gulong monitors_changed_id = 0;
 	GtkCssProvider *provider = NULL;
 
@@ -389,6 +377,22 @@ main (int argc, char **argv)
 	config_init ();
 	apply_gtk_config ();
 
+	/* Scaled backgrounds are kept next to the state file, and in the runtime
+	 * directory shared by greeters of other seats */
+	cache_dir = g_build_filename (config_get_state_dir (), "backgrounds", NULL);
+	shared_cache_dir = g_build_filename (g_get_user_runtime_dir (), "gooroom-greeter", "backgrounds", NULL);
+	shared_cache = config_get_string (CONFIG_GROUP_DEFAULT, CONFIG_KEY_BACKGROUND_SHARED_CACHE, shared_cache_dir);
+	background_cache_init (cache_dir, shared_cache,
+                           (gsize) MAX (0, config_get_int (CONFIG_GROUP_DEFAULT, CONFIG_KEY_BACKGROUND_CACHE_SIZE, 128)) << 20);
+	g_free (shared_cache);
+	g_free (shared_cache_dir);
+	g_free (cache_dir);
+
+	/* Built-in PAM message rules and translations are set up once */
+	pam_messages = config_get_string (CONFIG_GROUP_DEFAULT, CONFIG_KEY_PAM_MESSAGES, NULL);
+	pam_message_rules_init (pam_messages);
+	g_free (pam_messages);
+
 	/* Starting window manager */
 	wm_start ();
 
@@ -406,13 +410,40 @@ main (int argc, char **argv)
                            GDK_LEFT_PTR));
 
 	greeter_window = greeter_window_new ();
+	greeter_window_set_preauthenticate (GREETER_WINDOW (greeter_window),
+                                        config_get_bool (CONFIG_GROUP_DEFAULT, CONFIG_KEY_PREAUTHENTICATE, FALSE));
 
 	greeter_background = greeter_background_new (greeter_window);
 	background = config_get_string (CONFIG_GROUP_DEFAULT, CONFIG_KEY_BACKGROUND, NULL);
-	greeter_background_set_monitor_config (greeter_background, background);
-	greeter_background_connect (greeter_background, screen);
+	greeter_background_set_monitor_config (greeter_background, NULL, background);
 	g_free (background);
 
+	/* [monitor: NAME] sections, NAME is the monitor model or number */
+	monitors = config_get_groups (CONFIG_GROUP_MONITOR);
+	for (group = monitors; group && *group; ++group) {
+		gchar *name = g_strstrip (g_strdup (*group + sizeof (CONFIG_GROUP_MONITOR) - 1));
+		background = config_get_string (*group, CONFIG_KEY_BACKGROUND, NULL);
+		greeter_background_set_monitor_config (greeter_background, name, background);
+		g_free (background);
+		g_free (name);
+	}
+	g_strfreev (monitors);
+
+	greeter_background_set_use_pixmap (greeter_background,
+                                       config_get_bool (CONFIG_GROUP_DEFAULT, CONFIG_KEY_BACKGROUND_PIXMAP, FALSE));
+	placeholder = config_get_string (CONFIG_GROUP_DEFAULT, CONFIG_KEY_BACKGROUND_PLACEHOLDER, NULL);
+	greeter_background_set_placeholder_color (greeter_background, placeholder);
+	filter = config_get_string (CONFIG_GROUP_DEFAULT, CONFIG_KEY_BACKGROUND_FILTER, NULL);
+	greeter_background_set_scaling_filter (greeter_background, filter);
+	greeter_background_set_slideshow_interval (greeter_background,
+                                               config_get_int (CONFIG_GROUP_DEFAULT, CONFIG_KEY_BACKGROUND_SLIDESHOW_INTERVAL, 300));
+	backdrop = config_get_string (CONFIG_GROUP_DEFAULT, CONFIG_KEY_PANEL_BACKDROP, NULL);
+	greeter_background_set_panel_backdrop (greeter_background, backdrop);
+	greeter_background_connect (greeter_background, screen);
+	g_free (placeholder);
+	g_free (filter);
+	g_free (backdrop);
+
 	provider = gtk_css_provider_new ();
 	gtk_css_provider_load_from_resource (provider, "/kr/gooroom/greeter/theme.css");
 	gtk_style_context_add_provider_for_screen (screen,
@@ -429,6 +460,8 @@ main (int argc, char **argv)
 
 	g_signal_connect (greeter_window, "position-changed",
                       G_CALLBACK (greeter_window_active_monitor_changed_cb), NULL);
+	g_signal_connect (greeter_window, "session-starting",
+                      G_CALLBACK (greeter_window_session_starting_cb), NULL);
 
 
 //	monitors_changed_cb (screen, NULL);
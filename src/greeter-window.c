@@ -23,6 +23,7 @@
 #include <gtk/gtk.h>
 #include <glib/gi18n.h>
 #include <ctype.h>
+#include <stdlib.h>
 
 #include <lightdm.h>
 #include <upower.h>
@@ -35,6 +36,7 @@
 #include "splash-window.h"
 #include "indicator-button.h"
 #include "greeterconfiguration.h"
+#include "greeterpammessage.h"
 #include "greeter-message-dialog.h"
 #include "greeter-password-settings-dialog.h"
 
@@ -50,6 +52,7 @@ enum {
 enum
 {
 	POSITION_CHANGED,
+	SESSION_STARTING,
 	LAST_SIGNAL
 };
 
@@ -66,6 +69,15 @@ typedef struct
 	gchar *text;
 } PAMConversationMessage;
 
+/* Progress of the login started by the login button */
+typedef enum
+{
+	LOGIN_STATE_IDLE,              /* no login in progress */
+	LOGIN_STATE_PREAUTHENTICATING, /* started from the ID entry, messages are held until the login button */
+	LOGIN_STATE_WAITING_PROMPT,    /* authentication started, the password answers the first prompt */
+	LOGIN_STATE_RESPONDED,         /* password sent, waiting for PAM */
+	LOGIN_STATE_STARTING_SESSION   /* authenticated, waiting for LightDM to start the session */
+} LoginState;
 
 struct _GreeterWindowPrivate
 {
@@ -79,6 +91,8 @@ struct _GreeterWindowPrivate
 	GtkWidget *btn_suspend;
 	GtkWidget *btn_hibernate;
 	GtkWidget *pw_dialog;
+	/* Warning or question PAM waits on, see process_prompts () */
+	GtkWidget *message_dialog;
 	GtkWidget *spinner;
 	GtkWidget *switch_indicator;
 
@@ -93,14 +107,23 @@ struct _GreeterWindowPrivate
 	gboolean prompt_active;
 	gboolean have_pam_error;
 	gboolean changing_password;
+	gboolean connected;
+
+	LoginState login_state;
+
+	/* Speculative authentication, see preauthenticate () */
+	gboolean preauthenticate;
+	gchar   *preauth_id;
+	gint64   preauth_start_time;
+	gint64   preauth_prompt_time;
 
 	gchar *id;
 	gchar *pw;
 	gchar *current_session;
 	gchar *current_language;
 
-	/* Pending questions */
-	GSList *pending_questions;
+	/* Pending questions, oldest first */
+	GQueue *pending_questions;
 
 	guint  splash_timeout_id;
 
@@ -130,6 +153,33 @@ pam_message_finalize (PAMConversationMessage *message)
 	g_free (message);
 }
 
+static void
+pending_questions_clear (GreeterWindow *window)
+{
+	PAMConversationMessage *message;
+
+	while ((message = g_queue_pop_head (window->priv->pending_questions)))
+		pam_message_finalize (message);
+}
+
+static void
+pending_questions_push (GreeterWindow *window,
+                        gboolean       is_prompt,
+                        gint           type,
+                        const gchar   *text)
+{
+	PAMConversationMessage *message = g_new (PAMConversationMessage, 1);
+
+	message->is_prompt = is_prompt;
+	if (is_prompt)
+		message->type.prompt = type;
+	else
+		message->type.message = type;
+	message->text = g_strdup (text);
+
+	g_queue_push_tail (window->priv->pending_questions, message);
+}
+
 static gchar *
 get_id (GtkWidget *id_entry)
 {
@@ -201,12 +251,9 @@ start_authentication (GreeterWindow *window, const gchar *username)
 	priv->prompted = FALSE;
 	priv->prompt_active = FALSE;
 	priv->have_pam_error = FALSE;
+	priv->login_state = LOGIN_STATE_IDLE;
 
-	if (priv->pending_questions)
-	{
-		g_slist_free_full (priv->pending_questions, (GDestroyNotify) pam_message_finalize);
-		priv->pending_questions = NULL;
-	}
+	pending_questions_clear (window);
 
 	if (g_strcmp0 (username, "*other") == 0)
 	{
@@ -270,7 +317,7 @@ password_settings_dialog_response_cb (GtkDialog *dialog,
 			/* If we have questions pending, then we continue processing
 			 * those, until we are done. (Otherwise, authentication will
 			 * not complete.) */
-			if (priv->pending_questions)
+			if (!g_queue_is_empty (priv->pending_questions))
 				process_prompts (window);
 		}
 		return;
@@ -321,32 +368,26 @@ show_login_error_dialog (GreeterWindow *window,
 }
 
 static void
-run_warning_dialog (GreeterWindow *window,
-                    const gchar      *title,
-                    const gchar      *message,
-                    const gchar      *data)
+warning_dialog_response_cb (GtkDialog *dialog,
+                            gint       response_id,
+                            gpointer   user_data)
 {
-	GtkWidget *dialog;
-	gchar *response = NULL;
+	const gchar *data;
+	const gchar *response = NULL;
+	gboolean restart = FALSE;
+	GreeterWindow *window = GREETER_WINDOW (user_data);
 	GreeterWindowPrivate *priv = window->priv;
 
-	dialog = greeter_message_dialog_new (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (window))),
-                                         "dialog-warning-symbolic.symbolic",
-                                         title,
-                                         message);
-
-	gtk_dialog_add_buttons (GTK_DIALOG (dialog), _("Ok"), GTK_RESPONSE_OK, NULL);
-	gtk_dialog_set_default_response (GTK_DIALOG (dialog), GTK_RESPONSE_OK);
-
-	gtk_dialog_run (GTK_DIALOG (dialog));
-	gtk_widget_destroy (dialog);
+	data = g_object_get_data (G_OBJECT (dialog), "data");
 
 	if (data) {
 		if (g_str_equal (data, "CHPASSWD_FAILURE_OK")) {
 			priv->changing_password = FALSE;
 			gtk_entry_set_text (GTK_ENTRY (priv->pw_entry), "");
 			gtk_widget_grab_focus (priv->pw_entry);
-			start_authentication (window, lightdm_greeter_get_authentication_user (priv->lightdm));
+			restart = TRUE;
+		} else if (g_str_equal (data, "SESSION_FAILURE_OK")) {
+			restart = TRUE;
 		} else if (g_str_equal (data, "ACCT_EXP_OK")) {
 			response = "acct_exp_ok";
 		} else if (g_str_equal (data, "DEPT_EXP_OK")) {
@@ -360,6 +401,13 @@ run_warning_dialog (GreeterWindow *window,
 		}
 	}
 
+	gtk_widget_destroy (GTK_WIDGET (dialog));
+	priv->message_dialog = NULL;
+	priv->have_pam_error = TRUE;
+
+	if (restart)
+		start_authentication (window, lightdm_greeter_get_authentication_user (priv->lightdm));
+
 	if (response) {
 		if (lightdm_greeter_get_in_authentication (priv->lightdm)) {
 #ifdef HAVE_LIBLIGHTDMGOBJECT_1_19_2
@@ -370,7 +418,40 @@ run_warning_dialog (GreeterWindow *window,
 		}
 	}
 
+	/* Go on with what PAM sent while the dialog was shown */
+	process_prompts (window);
+}
+
+/* "data" tells warning_dialog_response_cb () how to go on */
+static void
+show_warning_dialog (GreeterWindow *window,
+                     const gchar      *title,
+                     const gchar      *message,
+                     const gchar      *data)
+{
+	GtkWidget *dialog;
+	GreeterWindowPrivate *priv = window->priv;
+
+	/* Only when the conversation ended meanwhile, nobody waits on it anymore */
+	g_clear_pointer (&priv->message_dialog, gtk_widget_destroy);
+
+	dialog = greeter_message_dialog_new (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (window))),
+                                         "dialog-warning-symbolic.symbolic",
+                                         title,
+                                         message);
+
+	gtk_dialog_add_buttons (GTK_DIALOG (dialog), _("Ok"), GTK_RESPONSE_OK, NULL);
+	gtk_dialog_set_default_response (GTK_DIALOG (dialog), GTK_RESPONSE_OK);
+	gtk_window_set_modal (GTK_WINDOW (dialog), TRUE);
+
+	g_object_set_data_full (G_OBJECT (dialog), "data", g_strdup (data), g_free);
+	g_signal_connect (G_OBJECT (dialog), "response",
+                      G_CALLBACK (warning_dialog_response_cb), window);
+
+	priv->message_dialog = dialog;
 	priv->have_pam_error = TRUE;
+
+	gtk_widget_show (dialog);
 }
 
 static gboolean
@@ -393,65 +474,39 @@ show_password_settings_dialog (GreeterWindow *window)
 }
 
 static void
-run_password_changing_dialog (GreeterWindow *window,
-                              const gchar      *title,
-                              const gchar      *message,
-                              const gchar      *yes,
-                              const gchar      *no,
-                              const gchar      *data)
-{
-	gint res;
-	GtkWidget *dialog;
-	const gchar *yes_text, *no_text;
-	GtkWidget *suggested_button;
-	GtkStyleContext *style = NULL;
+password_changing_dialog_response_cb (GtkDialog *dialog,
+                                      gint       response_id,
+                                      gpointer   user_data)
+{
+	gboolean req_response;
+	GreeterWindow *window = GREETER_WINDOW (user_data);
 	GreeterWindowPrivate *priv = window->priv;
 
-	dialog = greeter_message_dialog_new (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (window))),
-                                         "dialog-password-symbolic",
-                                         title,
-                                         message);
-
-	yes_text = (yes) ? yes : _("Ok");
-	no_text = (no) ? no : _("Cancel");
-
-	gtk_dialog_add_buttons (GTK_DIALOG (dialog),
-                            yes_text, GTK_RESPONSE_OK,
-                            no_text, GTK_RESPONSE_CANCEL,
-                            NULL);
-	gtk_dialog_set_default_response (GTK_DIALOG (dialog), GTK_RESPONSE_OK);
-
-	gtk_widget_show (dialog);
-
-	suggested_button = gtk_dialog_get_widget_for_response (GTK_DIALOG (dialog), GTK_RESPONSE_OK);
-	style = gtk_widget_get_style_context (suggested_button);
-	gtk_style_context_add_class (style, "suggested-action");
-	gtk_widget_queue_draw (dialog);
+	req_response = g_strcmp0 (g_object_get_data (G_OBJECT (dialog), "data"), "req_response") == 0;
 
-	res = gtk_dialog_run (GTK_DIALOG (dialog));
-	gtk_widget_destroy (dialog);
+	gtk_widget_destroy (GTK_WIDGET (dialog));
+	priv->message_dialog = NULL;
 
-	if (res == GTK_RESPONSE_OK) {
+	if (response_id == GTK_RESPONSE_OK) {
 		priv->changing_password = TRUE;
 
-		if (g_strcmp0 (data, "req_response") == 0) {
-			if (!show_password_settings_dialog (window))
-				goto out;
+		if (!show_password_settings_dialog (window))
+			goto out;
 
+		if (req_response) {
 #ifdef HAVE_LIBLIGHTDMGOBJECT_1_19_2
 			lightdm_greeter_respond (priv->lightdm, "chpasswd_yes", NULL);
 #else
 			lightdm_greeter_respond (priv->lightdm, "chpasswd_yes");
 #endif
-        } else {
-			if (!show_password_settings_dialog (window))
-				goto out;
 		}
 
+		/* Go on with what PAM sent while the dialog was shown */
+		process_prompts (window);
 		return;
 	}
 
-	if (g_strcmp0 (data, "req_response") == 0) {
+	if (req_response) {
 		if (lightdm_greeter_get_in_authentication (priv->lightdm)) {
 #ifdef HAVE_LIBLIGHTDMGOBJECT_1_19_2
 			lightdm_greeter_respond (priv->lightdm, "chpasswd_no", NULL);
@@ -468,6 +523,53 @@ out:
 	start_authentication (window, lightdm_greeter_get_authentication_user (priv->lightdm));
 }
 
+/* "data" is "req_response" when PAM waits for the answer */
+static void
+show_password_changing_dialog (GreeterWindow *window,
+                               const gchar      *title,
+                               const gchar      *message,
+                               const gchar      *yes,
+                               const gchar      *no,
+                               const gchar      *data)
+{
+	GtkWidget *dialog;
+	const gchar *yes_text, *no_text;
+	GtkWidget *suggested_button;
+	GtkStyleContext *style = NULL;
+	GreeterWindowPrivate *priv = window->priv;
+
+	/* Only when the conversation ended meanwhile, nobody waits on it anymore */
+	g_clear_pointer (&priv->message_dialog, gtk_widget_destroy);
+
+	dialog = greeter_message_dialog_new (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (window))),
+                                         "dialog-password-symbolic",
+                                         title,
+                                         message);
+
+	yes_text = (yes) ? yes : _("Ok");
+	no_text = (no) ? no : _("Cancel");
+
+	gtk_dialog_add_buttons (GTK_DIALOG (dialog),
+                            yes_text, GTK_RESPONSE_OK,
+                            no_text, GTK_RESPONSE_CANCEL,
+                            NULL);
+	gtk_dialog_set_default_response (GTK_DIALOG (dialog), GTK_RESPONSE_OK);
+	gtk_window_set_modal (GTK_WINDOW (dialog), TRUE);
+
+	g_object_set_data_full (G_OBJECT (dialog), "data", g_strdup (data), g_free);
+	g_signal_connect (G_OBJECT (dialog), "response",
+                      G_CALLBACK (password_changing_dialog_response_cb), window);
+
+	priv->message_dialog = dialog;
+
+	gtk_widget_show (dialog);
+
+	suggested_button = gtk_dialog_get_widget_for_response (GTK_DIALOG (dialog), GTK_RESPONSE_OK);
+	style = gtk_widget_get_style_context (suggested_button);
+	gtk_style_context_add_class (style, "suggested-action");
+	gtk_widget_queue_draw (dialog);
+}
+
 static void
 hide_splash (GreeterWindow *window)
 {
@@ -547,14 +649,39 @@ pre_login (GreeterWindow *window)
                                              showing_splash_timeout_cb, window);
 }
 
+/* Answers the password prompt of the login started by try_to_login_system() */
+static void
+respond_password (GreeterWindow *window)
+{
+	GreeterWindowPrivate *priv = window->priv;
+
+	priv->prompt_active = FALSE;
+	priv->login_state = LOGIN_STATE_RESPONDED;
+
+	if (lightdm_greeter_get_in_authentication (priv->lightdm)) {
+#ifdef HAVE_LIBLIGHTDMGOBJECT_1_19_2
+		lightdm_greeter_respond (priv->lightdm, priv->pw, NULL);
+#else
+		lightdm_greeter_respond (priv->lightdm, priv->pw);
+#endif
+	}
+
+	g_clear_pointer (&priv->pw, g_free);
+}
+
 static void
 process_prompts (GreeterWindow *window)
 {
 	const gchar *id;
+	PAMConversationMessage *head;
 	GreeterWindowPrivate *priv = window->priv;
 	LightDMGreeter *greeter = priv->lightdm;
 
-	if (!priv->pending_questions)
+	/* Nothing is shown before the login button is clicked, and the rest
+	 * waits until the dialog being shown is answered */
+	if (g_queue_is_empty (priv->pending_questions) ||
+	    priv->login_state == LOGIN_STATE_PREAUTHENTICATING ||
+	    priv->message_dialog)
 		return;
 
 	/* always allow the user to change username again */
@@ -565,9 +692,9 @@ process_prompts (GreeterWindow *window)
 
 	/* Special case: no user selected from list, so PAM asks us for the user
 	 * via a prompt. For that case, use the username field */
-	if (!priv->prompted && priv->pending_questions && !priv->pending_questions->next &&
-        ((PAMConversationMessage *) priv->pending_questions->data)->is_prompt &&
-        ((PAMConversationMessage *) priv->pending_questions->data)->type.prompt != LIGHTDM_PROMPT_TYPE_SECRET &&
+	head = g_queue_peek_head (priv->pending_questions);
+	if (!priv->prompted && g_queue_get_length (priv->pending_questions) == 1 &&
+        head->is_prompt && head->type.prompt != LIGHTDM_PROMPT_TYPE_SECRET &&
         gtk_widget_get_visible (priv->id_entry) &&
         lightdm_greeter_get_authentication_user (greeter) == NULL)
 	{
@@ -577,330 +704,40 @@ process_prompts (GreeterWindow *window)
 		return;
 	}
 
-	while (priv->pending_questions)
+	while (!g_queue_is_empty (priv->pending_questions))
 	{
-		PAMConversationMessage *message = (PAMConversationMessage *) priv->pending_questions->data;
-		priv->pending_questions = g_slist_remove (priv->pending_questions, (gconstpointer) message);
-
-		const gchar *filter_msg_000 = "You are required to change your password immediately";
-		const gchar *filter_msg_010 = g_dgettext("Linux-PAM", "You are required to change your password immediately (administrator enforced)");
-		const gchar *filter_msg_020 = g_dgettext("Linux-PAM", "You are required to change your password immediately (password expired)");
-		const gchar *filter_msg_030 = "Temporary Password";
-		const gchar *filter_msg_040 = "Password Maxday Warning";
-		const gchar *filter_msg_050 = "Account Expiration Warning";
-		const gchar *filter_msg_051 = "Division Expiration Warning";
-		const gchar *filter_msg_052 = "Password Expiration Warning";
-		const gchar *filter_msg_053 = _("your password will expire in");
-		const gchar *filter_msg_060 = "Duplicate Login Notification";
-		const gchar *filter_msg_070 = "Authentication Failure";
-        const gchar *filter_msg_071 = "Deleted Account";
-        const gchar *filter_msg_072 = "Invalid Account";
-        const gchar *filter_msg_073 = "No Exist Account";
-        const gchar *filter_msg_074 = "Policy Violation Account";
-        const gchar *filter_msg_075 = "Not Allowed IP";
-		const gchar *filter_msg_080 = "Account Locking";
-		const gchar *filter_msg_090 = "Account Expiration";
-		const gchar *filter_msg_100 = "Password Expiration";
-		const gchar *filter_msg_110 = "Duplicate Login";
-		const gchar *filter_msg_120 = "Division Expiration";
-		const gchar *filter_msg_130 = "Login Trial Exceed";
-		const gchar *filter_msg_140 = "Trial Period Expired";
-		const gchar *filter_msg_150 = "DateTime Error";
-		const gchar *filter_msg_160 = "Trial Period Warning";
-
-		if ((strstr (message->text, filter_msg_000) != NULL) ||
-		    (strstr (message->text, filter_msg_010) != NULL) ||
-            (strstr (message->text, filter_msg_020) != NULL)) {
-			post_login (window);
-			run_password_changing_dialog (window,
-                                          NULL,
-                                          _("Your password has expired.\n"
-                                            "Please change your password immediately."),
-                                          _("Changing Password"),
-                                          _("Cancel"),
-                                          "req_no_response");
-			continue;
-		} else if (g_str_has_prefix (message->text, filter_msg_030)) {
-			post_login (window);
-			run_password_changing_dialog (window,
-                                          NULL,
-                                          _("Your password has been issued temporarily.\n"
-                                            "For security reasons, please change your password immediately."),
-                                          _("Changing Password"),
-                                          _("Cancel"),
-                                          "req_no_response");
-			continue;
-		} else if (g_str_has_prefix (message->text, filter_msg_040)) {
-			post_login (window);
-
-			gchar *msg = NULL;
-			gchar **tokens = g_strsplit (message->text, ":", -1);
-			if (g_strv_length (tokens) > 1) {
-				if (g_str_equal (tokens[1], "1")) {
-					msg = g_strdup_printf (_("Please change your password for security.\n"
-                                             "If you do not change your password within %s day, "
-                                             "your password expires.\n"
-                                             "You can no longer log in.\n"
-                                             "Do you want to change password now?"), tokens[1]);
-				} else {
-					msg = g_strdup_printf (_("Please change your password for security.\n"
-                                             "If you do not change your password within %s days, "
-                                             "your password expires.\n"
-                                             "You can no longer log in.\n"
-                                             "Do you want to change password now?"), tokens[1]);
-				}
-			} else {
-				msg = g_strdup (_("Please change your password for security.\n"
-                                  "If you do not change your password within a few days, "
-                                  "your password expires.\n"
-                                  "You can no longer log in.\n"
-                                  "Do you want to change password now?"));
-			}
-			g_strfreev (tokens);
-
-			run_password_changing_dialog (window, NULL, msg, _("Change now"), _("Later"), "req_response");
-			g_free (msg);
-
-			continue;
-		} else if (g_str_has_prefix (message->text, filter_msg_050)) {
-			post_login (window);
-
-			gchar *msg = NULL;
-			gchar **tokens = g_strsplit (message->text, ":", -1);
-			if (g_strv_length (tokens) > 2) {
-				if (g_str_equal (tokens[1], "1")) {
-					msg = g_strdup_printf (_("Your account will not be available after %s.\n"
-                                             "Your account will expire in %s day."),
-                                           tokens[1], tokens[2]);
-				} else {
-					msg = g_strdup_printf (_("Your account will not be available after %s.\n"
-                                             "Your account will expire in %s days."),
-                                           tokens[1], tokens[2]);
-				}
-			}
-			g_strfreev (tokens);
-
-			run_warning_dialog (window, NULL, msg, "ACCT_EXP_OK");
-			g_free (msg);
-
-			continue;
-		} else if (g_str_has_prefix (message->text, filter_msg_051)) {
-			post_login (window);
-
-			gchar *msg = NULL;
-			gchar **tokens = g_strsplit (message->text, ":", -1);
-			if (g_strv_length (tokens) > 2) {
-				if (g_str_equal (tokens[1], "1")) {
-					msg = g_strdup_printf (_("Your organization will not be available after %s.\n"
-                                             "Your organization will expire in %s day."),
-                                           tokens[1], tokens[2]);
-				} else {
-					msg = g_strdup_printf (_("Your organization will not be available after %s.\n"
-                                             "Your organization will expire in %s days."),
-                                           tokens[1], tokens[2]);
-				}
-			}
-			g_strfreev (tokens);
-
-			run_warning_dialog (window, NULL, msg, "DEPT_EXP_OK");
-			g_free (msg);
-
-			continue;
-		} else if (g_str_has_prefix (message->text, filter_msg_052)) {
-			post_login (window);
-
-			gchar *msg = NULL;
-			gchar **tokens = g_strsplit (message->text, ":", -1);
-			if (g_strv_length (tokens) > 2) {
-				if (g_str_equal (tokens[1], "1")) {
-					msg = g_strdup_printf (_("Your password will not be available after %s.\n"
-                                             "Your password will expire in %s day."),
-                                           tokens[1], tokens[2]);
-				} else {
-					msg = g_strdup_printf (_("Your password will not be available after %s.\n"
-                                             "Your password will expire in %s days."),
-                                           tokens[1], tokens[2]);
-				}
+		gchar **fields;
+		const PamMessageRule *rule;
+		PAMConversationMessage *message = g_queue_pop_head (priv->pending_questions);
+
+		rule = pam_message_classify (message->text, &fields);
+		if (rule) {
+			gchar *msg = pam_message_format (rule, message->text, fields);
+
+			g_strfreev (fields);
+			pam_message_finalize (message);
+
+			if (rule->post_login)
+				post_login (window);
+
+			switch (rule->action) {
+				case PAM_MESSAGE_ACTION_CHANGE_PASSWORD:
+					show_password_changing_dialog (window, NULL, msg, rule->yes, rule->no, rule->response);
+					break;
+				case PAM_MESSAGE_ACTION_WARNING:
+					show_warning_dialog (window, NULL, msg, rule->response);
+					break;
+				case PAM_MESSAGE_ACTION_ERROR:
+					show_login_error_dialog (window, NULL, msg);
+					break;
 			}
-			g_strfreev (tokens);
-
-			run_warning_dialog (window, NULL, msg, "PASS_EXP_OK");
 			g_free (msg);
 
-			continue;
-		} else if ((strstr (message->text, filter_msg_053) != NULL)) {
-			run_warning_dialog (window, NULL, message->text, NULL);
-
-			continue;
-		} else if (g_str_has_prefix (message->text, filter_msg_060)) {
-			post_login (window);
-
-			GString *msg = g_string_new (_("Duplicate logins detected with the same ID."));
-			gchar **tokens = g_strsplit (message->text, ":", -1);
-			if (tokens[1]) {
-				gchar *text = g_strdup_printf ("%s : %s", _("Client ID"), tokens[1]);
-				g_string_append_printf (msg, "\n\n%s", text);
-				g_free (text);
-			}
-			if (tokens[2]) {
-				gchar *text = g_strdup_printf ("%s : %s", _("Client Name"), tokens[2]);
-				g_string_append_printf (msg, "\n%s", text);
-				g_free (text);
-			}
-			if (tokens[3]) {
-				gchar *text = g_strdup_printf ("%s : %s", _("IP"), tokens[3]);
-				g_string_append_printf (msg, "\n%s", text);
-				g_free (text);
-			}
-			if (tokens[4]) {
-				gchar *text = g_strdup_printf ("%s : %s", _("Local IP"), tokens[4]);
-				g_string_append_printf (msg, "\n%s", text);
-				g_free (text);
-			}
-
-			run_warning_dialog (window, NULL, msg->str, "DUPLICATE_LOGIN_OK");
-			g_string_free (msg, TRUE);
-
-			continue;
-		} else if (g_str_has_prefix (message->text, filter_msg_070)) {
-			post_login (window);
-
-			gchar *msg = NULL;
-			gchar **tokens = g_strsplit (message->text, ":", -1);
-			if (g_strv_length (tokens) > 1) {
-				msg = g_strdup_printf (_("Authentication Failure\n"
-                                         "You have %s login attempts remaining.\n"
-                                         "You can no longer log in when the maximum number of login "
-                                         "attempts is exceeded."), tokens[1]);
-			} else {
-				msg = g_strdup (_("The user could not be authenticated due to an unknown error.\n"
-                                  "Please contact the administrator."));
-			}
-			g_strfreev (tokens);
-			show_login_error_dialog (window, NULL, msg);
-			g_free (msg);
-			break;
-		} else if (g_str_has_prefix (message->text, filter_msg_071)) {
-			gchar *msg = g_strdup (_("This account has deleted and is no longer available.\n"
-                                     "Please contact the administrator."));
-			show_login_error_dialog (window, NULL, msg);
-			g_free (msg);
-			break;
-		} else if (g_str_has_prefix (message->text, filter_msg_072)) {
-			gchar *msg = g_strdup (_("You attempted to log in from an unregistered device.\n"
-                                     "Please contact the administrator."));
-			show_login_error_dialog (window, NULL, msg);
-			g_free (msg);
-			break;
-		} else if (g_str_has_prefix (message->text, filter_msg_073)) {
-			gchar *msg = g_strdup ( _("Authentication Failure\n"
-                                      "Please check the username and password and try again."));
-			show_login_error_dialog (window, NULL, msg);
-			g_free (msg);
-			break;
-		} else if (g_str_has_prefix (message->text, filter_msg_074)) {
-			gchar *msg = g_strdup (_("Login was denied because "
-                                     "it violated the policy set by the GPMS.\n"
-                                     "Please contact the administrator."));
-			show_login_error_dialog (window, NULL, msg);
-			g_free (msg);
-			break;
-		} else if (g_str_has_prefix (message->text, filter_msg_075)) {
-			gchar *msg = g_strdup (_("Login was denied because "
-                                     "it violated the policy(Allowed IP) set by the GPMS.\n"
-                                     "Please contact the administrator."));
-			show_login_error_dialog (window, NULL, msg);
-			g_free (msg);
-			break;
-		} else if (g_str_has_prefix (message->text, filter_msg_080)) {
-			post_login (window);
-
-			gchar *msg = g_strdup (_("Your account has been locked because\n"
-                                     "you have exceeded the number of login attempts.\n"
-                                     "Please try again in a moment."));
-			show_login_error_dialog (window, NULL, msg);
-			g_free (msg);
-			break;
-		} else if (g_str_has_prefix (message->text, filter_msg_090)) {
-			post_login (window);
-
-			gchar *msg = g_strdup (_("This account has expired and is no longer available.\n"
-                                     "Please contact the administrator."));
-			show_login_error_dialog (window, NULL, msg);
-			g_free (msg);
-			break;
-		} else if (g_str_has_prefix (message->text, filter_msg_100)) {
-			post_login (window);
-
-			gchar *msg = g_strdup (_("The password for your account has expired.\n"
-                                     "Please contact the administrator."));
-			show_login_error_dialog (window, NULL, msg);
-			g_free (msg);
-			break;
-		} else if (g_str_has_prefix (message->text, filter_msg_110)) {
-			post_login (window);
-
-			gchar *msg = g_strdup (_("You are already logged in.\n"
-                                     "Log out of the other device and try again.\n"
-                                     "If the problem persists, please contact your administrator."));
-			show_login_error_dialog (window, NULL, msg);
-			g_free (msg);
-			break;
-		} else if (g_str_has_prefix (message->text, filter_msg_120)) {
-			post_login (window);
-
-			gchar *msg = g_strdup (_("Due to the expiration of your organization, "
-                                     "this account is no longer available.\n"
-                                     "Please contact the administrator."));
-			show_login_error_dialog (window, NULL, msg);
-			g_free (msg);
-			break;
-		} else if (g_str_has_prefix (message->text, filter_msg_130)) {
-			post_login (window);
-
-			gchar *msg = g_strdup (_("Login attempts exceeded the number of times,\n"
-                                     "so you cannot login for a certain period of time.\n"
-                                     "Please try again in a moment."));
-			show_login_error_dialog (window, NULL, msg);
-			g_free (msg);
-			break;
-		} else if (g_str_has_prefix (message->text, filter_msg_140)) {
-			post_login (window);
-
-			gchar *msg = g_strdup (_("Trial period has expired."));
-			show_login_error_dialog (window, NULL, msg);
-			g_free (msg);
-			break;
-		} else if (g_str_has_prefix (message->text, filter_msg_150)) {
-			post_login (window);
-
-			gchar *msg = g_strdup (_("Time error occurred."));
-			show_login_error_dialog (window, NULL, msg);
-			g_free (msg);
-			break;
-		} else if (g_str_has_prefix (message->text, filter_msg_160)) {
-			post_login (window);
-
-			gchar *msg = NULL;
-			gchar **tokens = g_strsplit (message->text, ":", -1);
-			if (g_strv_length (tokens) > 2) {
-				if (g_str_equal (tokens[2], "0")) {
-					msg = g_strdup_printf (_("The trial period is up to %s days.\n"
-                                             "The trial period expires today."), tokens[1]);
-				} else if (g_str_equal (tokens[2], "1")){
-					msg = g_strdup_printf (_("The trial period is up to %s days.\n"
-                                             "%s day left to expire."), tokens[1], tokens[2]);
-				} else {
-					msg = g_strdup_printf (_("The trial period is up to %s days.\n"
-                                             "%s days left to expire."), tokens[1], tokens[2]);
-				}
-			} else {
-				msg = g_strdup (_("The trial period is unknown."));
-			}
-			g_strfreev (tokens);
+			/* Nothing after an error is shown, the dialog response
+			 * handlers call us again for the rest */
+			if (rule->action == PAM_MESSAGE_ACTION_ERROR || priv->message_dialog)
+				break;
 
-			run_warning_dialog (window, NULL, msg, "TRIAL_LOGIN_OK");
-			g_free (msg);
 			continue;
 		}
 
@@ -917,6 +754,7 @@ process_prompts (GreeterWindow *window)
 			} else {
 				show_login_error_dialog (window, NULL, message->text);
 			}
+			pam_message_finalize (message);
 			continue;
         }
 
@@ -953,21 +791,64 @@ process_prompts (GreeterWindow *window)
 			greeter_password_settings_dialog_grab_entry_focus (GREETER_PASSWORD_SETTINGS_DIALOG (priv->pw_dialog));
 		}
 
+		pam_message_finalize (message);
+
 		priv->prompted = TRUE;
 		priv->prompt_active = TRUE;
 
+		/* The first prompt of a login asks for the password typed before
+		 * the click, answer it and go on with what PAM queued after it. */
+		if (priv->login_state == LOGIN_STATE_WAITING_PROMPT) {
+			respond_password (window);
+			continue;
+		}
+
         /* If we have more stuff after a prompt, assume that other prompts are pending,
          * so stop here. */
         break;
     }
 }
 
+static void
+start_session_failed (GreeterWindow *window)
+{
+	GreeterWindowPrivate *priv = window->priv;
+
+	priv->login_state = LOGIN_STATE_IDLE;
+	post_login (window);
+
+	show_warning_dialog (window, NULL, _("Failed to start session"), "SESSION_FAILURE_OK");
+}
+
+#ifdef HAVE_LIBLIGHTDMGOBJECT_1_19_2
+static void
+start_session_cb (GObject      *object,
+                  GAsyncResult *result,
+                  gpointer      user_data)
+{
+	GError *error = NULL;
+	GreeterWindow *window = GREETER_WINDOW (user_data);
+
+	/* On success LightDM stops the greeter, nothing more to do */
+	if (!lightdm_greeter_start_session_finish (LIGHTDM_GREETER (object), result, &error)) {
+		g_warning ("Failed to start session: %s", error ? error->message : "unknown error");
+		g_clear_error (&error);
+		start_session_failed (window);
+	}
+
+	g_object_unref (window);
+}
+#endif
+
+/* The splash keeps animating while LightDM starts the session */
 static void
 start_session (GreeterWindow *window)
 {
 	GreeterWindowPrivate *priv = window->priv;
 	LightDMGreeter *greeter = priv->lightdm;
 
+	priv->login_state = LOGIN_STATE_STARTING_SESSION;
+
 	if (priv->current_language)
 #ifdef HAVE_LIBLIGHTDMGOBJECT_1_19_2
 		lightdm_greeter_set_language (greeter, priv->current_language, NULL);
@@ -975,12 +856,16 @@ start_session (GreeterWindow *window)
 		lightdm_greeter_set_language (greeter, priv->current_language);
 #endif
 
-//	greeter_background_save_xroot (greeter_background);
+	/* Last chance to hand over anything to the session */
+	g_signal_emit (G_OBJECT (window), signals[SESSION_STARTING], 0);
 
-	if (!lightdm_greeter_start_session_sync (greeter, priv->current_session, NULL)) {
-		run_warning_dialog (window, NULL, _("Failed to start session"), NULL);
-		start_authentication (window, lightdm_greeter_get_authentication_user (greeter));
-	}
+#ifdef HAVE_LIBLIGHTDMGOBJECT_1_19_2
+	lightdm_greeter_start_session (greeter, priv->current_session, NULL,
+                                   start_session_cb, g_object_ref (window));
+#else
+	if (!lightdm_greeter_start_session_sync (greeter, priv->current_session, NULL))
+		start_session_failed (window);
+#endif
 }
 
 static void
@@ -992,14 +877,10 @@ show_prompt_cb (LightDMGreeter    *greeter,
 	GreeterWindow *window = GREETER_WINDOW (user_data);
 	GreeterWindowPrivate *priv = window->priv;
 
-	PAMConversationMessage *message_obj = g_new (PAMConversationMessage, 1);
-	if (message_obj)
-	{
-		message_obj->is_prompt = TRUE;
-		message_obj->type.prompt = type;
-		message_obj->text = g_strdup (text);
-		priv->pending_questions = g_slist_append (priv->pending_questions, message_obj);
-	}
+	pending_questions_push (window, TRUE, type, text);
+
+	if (priv->login_state == LOGIN_STATE_PREAUTHENTICATING && priv->preauth_prompt_time == 0)
+		priv->preauth_prompt_time = g_get_monotonic_time ();
 
 	if (!priv->prompt_active)
 		process_prompts (window);
@@ -1014,17 +895,10 @@ show_message_cb (LightDMGreeter     *greeter,
 	GreeterWindow *window = GREETER_WINDOW (user_data);
 	GreeterWindowPrivate *priv = window->priv;
 
-    PAMConversationMessage *message_obj = g_new (PAMConversationMessage, 1);
-    if (message_obj)
-    {
-        message_obj->is_prompt = FALSE;
-        message_obj->type.message = type;
-        message_obj->text = g_strdup (text);
-        priv->pending_questions = g_slist_append (priv->pending_questions, message_obj);
-    }
+	pending_questions_push (window, FALSE, type, text);
 
-    if (!priv->prompt_active)
-        process_prompts (window);
+	if (!priv->prompt_active)
+		process_prompts (window);
 }
 
 static void
@@ -1034,14 +908,20 @@ authentication_complete_cb (LightDMGreeter *greeter,
 	GreeterWindow *window = GREETER_WINDOW (user_data);
 	GreeterWindowPrivate *priv = window->priv;
 
-	post_login (window);
+	/* A speculative authentication that ended or was cancelled before
+	 * the login button, the click starts a new one. */
+	if (priv->login_state == LOGIN_STATE_PREAUTHENTICATING) {
+		priv->login_state = LOGIN_STATE_IDLE;
+		g_clear_pointer (&priv->preauth_id, g_free);
+		pending_questions_clear (window);
+		return;
+	}
 
 	priv->prompt_active = FALSE;
+	priv->login_state = LOGIN_STATE_IDLE;
+	g_clear_pointer (&priv->pw, g_free);
 
-	if (priv->pending_questions) {
-		g_slist_free_full (priv->pending_questions, (GDestroyNotify) pam_message_finalize);
-		priv->pending_questions = NULL;
-	}
+	pending_questions_clear (window);
 
 	if (lightdm_greeter_get_is_authenticated (greeter)) {
 		if (priv->pw_dialog) {
@@ -1050,6 +930,8 @@ authentication_complete_cb (LightDMGreeter *greeter,
 		}
 		start_session (window);
 	} else {
+		post_login (window);
+
 		if (priv->changing_password) {
 			gchar *msg = NULL;
 
@@ -1072,7 +954,7 @@ authentication_complete_cb (LightDMGreeter *greeter,
                         "so the change of password is terminated.\n"
                         "Please try again later.");
 			}
-			run_warning_dialog (window, NULL, msg, "CHPASSWD_FAILURE_OK");
+			show_warning_dialog (window, NULL, msg, "CHPASSWD_FAILURE_OK");
 			return;
 		}
 
@@ -1119,43 +1001,96 @@ authentication_complete_cb (LightDMGreeter *greeter,
 //    }
 //}
 
+/* Starts authenticating the entered ID before the login button is clicked,
+ * so PAM looks the account up while the password is typed. */
 static void
-try_to_login_system (GreeterWindow *window)
+preauthenticate (GreeterWindow *window)
 {
-	gchar *id = NULL, *pw = NULL;
+	gchar *id;
 	GreeterWindowPrivate *priv = window->priv;
 
+	if (!priv->preauthenticate || !priv->connected || priv->changing_password || priv->pw_dialog ||
+	    (priv->login_state != LOGIN_STATE_IDLE &&
+	     priv->login_state != LOGIN_STATE_PREAUTHENTICATING))
+		return;
+
 	id = get_id (priv->id_entry);
-	pw = g_strdup (gtk_entry_get_text (GTK_ENTRY (priv->pw_entry)));
 
-	if (strlen (id) == 0)
-		goto out;
+	if (strlen (id) > 0 && g_strcmp0 (id, priv->preauth_id) != 0) {
+		g_debug ("[Login] Pre-authenticating");
 
-	start_authentication (window, id);
+		start_authentication (window, id);
+		priv->login_state = LOGIN_STATE_PREAUTHENTICATING;
+		priv->preauth_start_time = g_get_monotonic_time ();
+		priv->preauth_prompt_time = 0;
+		g_clear_pointer (&priv->preauth_id, g_free);
+		priv->preauth_id = id;
+		return;
+	}
 
-	while (!priv->prompted)
-		gtk_main_iteration ();
+	g_free (id);
+}
 
-	priv->prompt_active = FALSE;
+/* The ID was edited after pre-authentication started */
+static void
+cancel_preauthentication (GreeterWindow *window)
+{
+	GreeterWindowPrivate *priv = window->priv;
+
+	if (priv->login_state != LOGIN_STATE_PREAUTHENTICATING || !priv->preauth_id)
+		return;
 
+	g_debug ("[Login] Pre-authentication cancelled");
+
+	g_clear_pointer (&priv->preauth_id, g_free);
+	pending_questions_clear (window);
 
 	if (lightdm_greeter_get_in_authentication (priv->lightdm)) {
 #ifdef HAVE_LIBLIGHTDMGOBJECT_1_19_2
-		lightdm_greeter_respond (priv->lightdm, pw, NULL);
+		lightdm_greeter_cancel_authentication (priv->lightdm, NULL);
 #else
-		lightdm_greeter_respond (priv->lightdm, pw);
+		lightdm_greeter_cancel_authentication (priv->lightdm);
 #endif
-        /* If we have questions pending, then we continue processing
-         * those, until we are done. (Otherwise, authentication will
-         * not complete.) */
-		if (priv->pending_questions) {
-			process_prompts (window);
-		}
+	}
+	priv->login_state = LOGIN_STATE_IDLE;
+}
+
+/* Returns right away, the password is sent by process_prompts() when
+ * PAM asks for it and authentication_complete_cb() finishes the login. */
+static void
+try_to_login_system (GreeterWindow *window)
+{
+	gchar *id;
+	GreeterWindowPrivate *priv = window->priv;
+
+	id = get_id (priv->id_entry);
+
+	if (strlen (id) == 0)
+		goto out;
+
+	/* Carry on with the pre-authentication of this ID and the messages it held */
+	if (priv->login_state == LOGIN_STATE_PREAUTHENTICATING &&
+	    g_strcmp0 (id, priv->preauth_id) == 0 &&
+	    lightdm_greeter_get_in_authentication (priv->lightdm)) {
+		gint64 now = g_get_monotonic_time ();
+		gint64 ready = priv->preauth_prompt_time ? priv->preauth_prompt_time : now;
+
+		g_debug ("[Login] Pre-authentication hid %" G_GINT64_FORMAT " ms%s",
+		         (ready - priv->preauth_start_time) / 1000,
+		         priv->preauth_prompt_time ? "" : ", still waiting for the prompt");
+
+		g_clear_pointer (&priv->preauth_id, g_free);
+		priv->login_state = LOGIN_STATE_WAITING_PROMPT;
+		process_prompts (window);
+		goto out;
 	}
 
+	g_clear_pointer (&priv->preauth_id, g_free);
+	start_authentication (window, id);
+	priv->login_state = LOGIN_STATE_WAITING_PROMPT;
+
 out:
 	g_free (id);
-	g_free (pw);
 }
 
 static void
@@ -1165,6 +1100,9 @@ login_button_clicked_cb (GtkButton *widget,
 	GreeterWindow *window = GREETER_WINDOW (user_data);
 	GreeterWindowPrivate *priv = window->priv;
 
+	if (priv->login_state == LOGIN_STATE_STARTING_SESSION)
+		return;
+
 	pre_login (window);
 
 	g_clear_pointer (&priv->id, g_free);
@@ -1198,6 +1136,7 @@ id_entry_key_press_cb (GtkWidget   *widget,
 	if ((event->keyval == GDK_KEY_Return || event->keyval == GDK_KEY_Tab) &&
          gtk_widget_get_visible (priv->pw_entry))
 	{
+		preauthenticate (window);
 		gtk_widget_grab_focus (priv->pw_entry);
 		return TRUE;
 	} else {
@@ -1215,7 +1154,19 @@ id_entry_changed_cb (GtkWidget *widget,
 
 	text = gtk_entry_get_text (GTK_ENTRY (priv->id_entry));
 
-	gtk_widget_set_sensitive (priv->login_button, strlen (text) > 0);
+	gtk_widget_set_sensitive (priv->login_button, priv->connected && strlen (text) > 0);
+
+	cancel_preauthentication (window);
+}
+
+static gboolean
+id_entry_focus_out_cb (GtkWidget     *widget,
+                       GdkEventFocus *event,
+                       gpointer       user_data)
+{
+	preauthenticate (GREETER_WINDOW (user_data));
+
+	return FALSE;
 }
 
 static void
@@ -1928,6 +1879,48 @@ load_power_command (GreeterWindow *window)
                       G_CALLBACK (hibernate_button_clicked_cb), window);
 }
 
+static void
+lightdm_greeter_connected (GreeterWindow *window)
+{
+	GreeterWindowPrivate *priv = window->priv;
+
+	priv->connected = TRUE;
+
+	/* set default session, hints are only known once connected */
+	set_session (window, lightdm_greeter_get_default_session_hint (priv->lightdm));
+
+	gtk_widget_set_sensitive (priv->login_button,
+                              strlen (gtk_entry_get_text (GTK_ENTRY (priv->id_entry))) > 0);
+}
+
+/* Nobody could ever log in, LightDM starts a new greeter when this one fails */
+static void
+lightdm_greeter_connect_failed (const gchar *message)
+{
+	g_warning ("Failed to connect to LightDM: %s", message ? message : "unknown error");
+	exit (EXIT_FAILURE);
+}
+
+#ifdef HAVE_LIBLIGHTDMGOBJECT_1_19_2
+static void
+lightdm_greeter_connect_cb (GObject      *object,
+                            GAsyncResult *result,
+                            gpointer      user_data)
+{
+	GError *error = NULL;
+	GreeterWindow *window = GREETER_WINDOW (user_data);
+
+	if (lightdm_greeter_connect_to_daemon_finish (LIGHTDM_GREETER (object), result, &error)) {
+		lightdm_greeter_connected (window);
+	} else {
+		lightdm_greeter_connect_failed (error ? error->message : NULL);
+	}
+
+	g_object_unref (window);
+}
+#endif
+
+/* Called before the widget tree is built, the daemon answers meanwhile */
 static void
 lightdm_greeter_init (GreeterWindow *window)
 {
@@ -1941,10 +1934,10 @@ lightdm_greeter_init (GreeterWindow *window)
                       G_CALLBACK (authentication_complete_cb), window);
 //	g_signal_connect (greeter, "autologin-timer-expired", G_CALLBACK (timed_autologin_cb), window);
 
-	/* set default session */
-	set_session (window, lightdm_greeter_get_default_session_hint (priv->lightdm));
-
-	lightdm_greeter_connect_sync (priv->lightdm, NULL);
+#ifdef HAVE_LIBLIGHTDMGOBJECT_1_19_2
+	lightdm_greeter_connect_to_daemon (priv->lightdm, NULL,
+                                       lightdm_greeter_connect_cb, g_object_ref (window));
+#endif
 }
 
 static void
@@ -1958,12 +1951,13 @@ greeter_window_finalize (GObject *object)
 
 	g_clear_pointer (&priv->id, g_free);
 	g_clear_pointer (&priv->pw, g_free);
+	g_clear_pointer (&priv->preauth_id, g_free);
 	g_clear_pointer (&priv->current_session, g_free);
 	g_clear_pointer (&priv->current_language, g_free);
 
 	if (priv->pending_questions) {
-		g_slist_free_full (priv->pending_questions, (GDestroyNotify) pam_message_finalize);
-		priv->pending_questions = NULL;
+		pending_questions_clear (window);
+		g_clear_pointer (&priv->pending_questions, g_queue_free);
 	}
 
 	G_OBJECT_CLASS (greeter_window_parent_class)->finalize (object);
@@ -1975,13 +1969,19 @@ greeter_window_init (GreeterWindow *window)
 	GreeterWindowPrivate *priv;
 	priv = window->priv = greeter_window_get_instance_private (window);
 
+	priv->connected = FALSE;
+	lightdm_greeter_init (window);
+
 	gtk_widget_init_template (GTK_WIDGET (window));
 
 	priv->prompted = FALSE;
 	priv->prompt_active = FALSE;
 	priv->have_pam_error = FALSE;
 	priv->changing_password = FALSE;
-	priv->pending_questions = NULL;
+	priv->login_state = LOGIN_STATE_IDLE;
+	priv->preauthenticate = FALSE;
+	priv->preauth_id = NULL;
+	priv->pending_questions = g_queue_new ();
 	priv->current_session = NULL;
 	priv->current_language = NULL;
 	priv->id = NULL;
@@ -1990,8 +1990,6 @@ greeter_window_init (GreeterWindow *window)
 	priv->up_client = NULL;
 	priv->changing_password_step = 0;
 
-	lightdm_greeter_init (window);
-
 	load_power_command (window);
 	load_indicators (window);
 
@@ -1999,10 +1997,17 @@ greeter_window_init (GreeterWindow *window)
 
 	g_signal_connect (priv->id_entry, "changed", G_CALLBACK (id_entry_changed_cb), window);
 	g_signal_connect (priv->id_entry, "key-press-event", G_CALLBACK (id_entry_key_press_cb), window);
+	g_signal_connect (priv->id_entry, "focus-out-event", G_CALLBACK (id_entry_focus_out_cb), window);
 	g_signal_connect (priv->pw_entry, "activate", G_CALLBACK (pw_entry_activate_cb), window);
 	g_signal_connect (priv->login_button, "clicked", G_CALLBACK (login_button_clicked_cb), window);
 
 	g_idle_add ((GSourceFunc)grab_focus_idle, priv->id_entry);
+
+#ifndef HAVE_LIBLIGHTDMGOBJECT_1_19_2
+	if (!lightdm_greeter_connect_sync (priv->lightdm, NULL))
+		lightdm_greeter_connect_failed (NULL);
+	lightdm_greeter_connected (window);
+#endif
 }
 
 static void
@@ -2026,6 +2031,15 @@ greeter_window_class_init (GreeterWindowClass *klass)
                       G_TYPE_NONE, 1,
                       GDK_TYPE_RECTANGLE);
 
+	signals[SESSION_STARTING] =
+		g_signal_new ("session-starting",
+                      G_TYPE_FROM_CLASS(object_class),
+                      G_SIGNAL_RUN_FIRST,
+                      G_STRUCT_OFFSET (GreeterWindowClass, session_starting),
+                      NULL, NULL,
+                      g_cclosure_marshal_VOID__VOID,
+                      G_TYPE_NONE, 0);
+
 	gtk_widget_class_bind_template_child_private (widget_class, GreeterWindow, spinner);
 	gtk_widget_class_bind_template_child_private (widget_class, GreeterWindow, id_entry);
 	gtk_widget_class_bind_template_child_private (widget_class, GreeterWindow, pw_entry);
@@ -2057,3 +2071,9 @@ greeter_window_set_switch_indicator_visible (GreeterWindow *window, gboolean vis
 		gtk_widget_hide (window->priv->switch_indicator);
 	}
 }
+
+void
+greeter_window_set_preauthenticate (GreeterWindow *window, gboolean preauthenticate)
+{
+	window->priv->preauthenticate = preauthenticate;
+}
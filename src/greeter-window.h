@@ -38,6 +38,7 @@ struct _GreeterWindowClass {
 	GtkBoxClass __parent_class__;
 
 	void (*position_changed) (GreeterWindow *window, GdkRectangle *geometry);
+	void (*session_starting) (GreeterWindow *window);
 };
 
 GType       greeter_window_get_type                     (void); G_GNUC_CONST
@@ -47,6 +48,9 @@ GtkWidget  *greeter_window_new                          (void);
 void        greeter_window_set_switch_indicator_visible (GreeterWindow *window,
                                                          gboolean       visible);
 
+void        greeter_window_set_preauthenticate          (GreeterWindow *window,
+                                                         gboolean       preauthenticate);
+
 G_END_DECLS
 
 #endif /* __GREETER_WINDOW_H__ */
@@ -22,10 +22,14 @@
 #include <gdk/gdkx.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <string.h>
+#include <sys/resource.h>
 #include <X11/Xatom.h>
 #include <glib/gi18n.h>
 
 #include "greeterbackground.h"
+#include "greeterbackgroundcache.h"
+#include "greeterlayout.h"
+#include "greeterimage.h"
 
 typedef enum
 {
@@ -37,17 +41,6 @@ typedef enum
 	BACKGROUND_TYPE_IMAGE
 } BackgroundType;
 
-typedef enum
-{
-    /* It is not really useful, used for debugging */
-	SCALING_MODE_SOURCE,
-    /* Default mode for values without mode prefix */
-	SCALING_MODE_ZOOMED,
-	SCALING_MODE_SCALED,
-	SCALING_MODE_STRETCHED
-} ScalingMode;
-
-
 /* Background configuration (parsed from background=... option).
    Used to fill <Background> */
 typedef struct
@@ -60,6 +53,8 @@ typedef struct
         {
             gchar *path;
             ScalingMode mode;
+            /* Slideshow images, NULL for a single image (then "path") */
+            gchar **slides;
         } image;
     } options;
 } BackgroundConfig;
@@ -78,26 +73,92 @@ typedef struct
 	BackgroundType type;
 	union
 	{
-		GdkPixbuf* image;
+		/* Scaled image, opaque RGB24 cairo image surface */
+		cairo_surface_t* image;
 		GdkRGBA color;
 	} options;
+	/* Screen area covered by the image, in logical pixels: monitor geometry
+	   or the bounding box of all monitors in spanned mode */
+	GdkRectangle area;
+	gboolean spanned;
+	/* Low resolution image shown until the image is loaded */
+	cairo_surface_t* preview;
+	/* Device-ready copy of the image, created similar to the monitor window */
+	cairo_surface_t* surface;
+	/* Image key (path, mode, device size and scale) used to share and load images.
+	   Image stays NULL until asynchronous loading is finished */
+	gchar* key;
 } Background;
 
+/* Asynchronous loading of one image file for all monitors */
+typedef struct
+{
+	gchar* path;
+	/* Key => <BackgroundLoadTarget*> */
+	GHashTable* targets;
+	/* Decoded source images shared by all targets, see image_load_file() */
+	GHashTable* sources;
+	GMutex sources_lock;
+	/* Shared low resolution source, see image_load_preview() */
+	GdkPixbuf* preview;
+	gboolean preview_loaded;
+	GMutex preview_lock;
+	/* Monotonic time of windows creation */
+	gint64 start_time;
+	/* Targets not prepared yet, sources are released when it drops to 0 */
+	gint pending;
+} BackgroundLoadData;
+
+/* One monitor image, prepared in a pool thread */
+typedef struct
+{
+	BackgroundLoadData* data;
+	/* Also key in data->targets */
+	const gchar* key;
+	ScalingMode mode;
+	ScalerFilter filter;
+	/* Device pixels */
+	gint width;
+	gint height;
+	gint scale;
+	/* Result */
+	cairo_surface_t* image;
+} BackgroundLoadTarget;
+
 typedef struct
 {
 	GreeterBackground* object;
 	gint number;
 	gchar* name;
+	/* Logical pixels */
 	GdkRectangle geometry;
+	/* Device pixels per logical pixel */
+	gint scale;
 	GtkWindow* window;
 	gulong window_draw_handler_id;
 
+	/* Config the background was created from */
+	const MonitorConfig* config;
 	Background* background;
 
+	/* Slideshow: next slide loaded ahead, previous one while crossfading */
+	Background* next_background;
+	Background* previous_background;
+	/* Crossfade driven by the window frame clock, 0.0 .. 1.0 */
+	gdouble transition_progress;
+	gint64 transition_start;
+	guint transition_tick_id;
 } Monitor;
 
-static const gchar* SCALING_MODE_PREFIXES[] = {
-	"#source:", "#zoomed:", "#scaled:", "#stretched:", NULL };
+/* Delay before monitors are reconciled after the last "monitors-changed", ms */
+#define MONITORS_CHANGED_DELAY 250
+
+/* Blur radius of the "blur" panel backdrop, logical pixels */
+#define PANEL_BACKDROP_BLUR_RADIUS 12
+
+/* Slideshow crossfade duration, ms */
+#define SLIDESHOW_TRANSITION_DURATION 1500
+
 static const Monitor INVALID_MONITOR_STRUCT = {0,};
 
 
@@ -136,6 +197,9 @@ struct _GreeterBackgroundPrivate
 	/* Default config for unlisted monitors */
     MonitorConfig* default_monitor_config;
 
+    /* Name or "Number" => <MonitorConfig*>, from [monitor: NAME] sections */
+	GHashTable* configs;
+
     /* Array of configured monitors for current screen */
 	Monitor* monitors;
 	gsize monitors_size;
@@ -144,14 +208,44 @@ struct _GreeterBackgroundPrivate
 	GHashTable* monitors_map;
 
 	const Monitor* active_monitor;
+
+	/* Let the X server paint monitor windows from a pixmap */
+	gboolean use_pixmap;
+
+	/* Painted until image backgrounds are loaded */
+	GdkRGBA placeholder_color;
+
+	/* Resampling filter for each scaling mode */
+	ScalerFilter scaling_filters[SCALING_MODE_COUNT];
+
+	/* Bounding box of all monitors */
+	GdkRectangle screen_geometry;
+
+	/* Cancels pending image loading on disconnect */
+	GCancellable* load_cancellable;
+
+	/* Persistent toplevel of the child, placed over the active monitor */
+	GtkWindow* panel_window;
+
+	/* Debounced "monitors-changed" handling */
+	LayoutDebounce reconcile;
+
+	/* Panel background with the child backdrop composited in, blur radius
+	 * (-1 when disabled) and child area it was made for */
+	gint panel_backdrop_blur;
+	cairo_surface_t* panel_backdrop;
+	GdkRectangle panel_backdrop_area;
+
+	/* Slideshow: seconds per slide (0 disables), slide shown on all monitors,
+	 * and the interval is over while the next slide is still loading */
+	guint slideshow_interval;
+	guint slideshow_index;
+	guint slideshow_timer_id;
+	gboolean slideshow_due;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE(GreeterBackground, greeter_background, G_TYPE_OBJECT);
 
-/* Implemented in gooroom-greeter.c */
-gpointer greeter_save_focus(GtkWidget* widget);
-void greeter_restore_focus(const gpointer saved_data);
-
 static const MonitorConfig DEFAULT_MONITOR_CONFIG =
 {
     .bg =
@@ -164,6 +258,11 @@ static const MonitorConfig DEFAULT_MONITOR_CONFIG =
     }
 };
 
+/* Called back when slides are loaded and crossfades end */
+static void greeter_background_slideshow_schedule (GreeterBackground* background);
+/* Called back once a burst of "monitors-changed" is over */
+static void greeter_background_reconcile_cb (guint events, gpointer user_data);
+
 
 
 
@@ -173,7 +272,7 @@ background_finalize (Background* bg)
 	switch (bg->type)
 	{
 		case BACKGROUND_TYPE_IMAGE:
-			g_clear_object (&bg->options.image);
+			g_clear_pointer (&bg->options.image, cairo_surface_destroy);
 			break;
 		case BACKGROUND_TYPE_COLOR:
 			break;
@@ -181,9 +280,20 @@ background_finalize (Background* bg)
 			g_return_if_reached();
 	}
 
+	g_clear_pointer (&bg->preview, cairo_surface_destroy);
+	g_clear_pointer (&bg->surface, cairo_surface_destroy);
+	g_clear_pointer (&bg->key, g_free);
+
 	bg->type = BACKGROUND_TYPE_INVALID;
 }
 
+static Background*
+background_ref (Background* bg)
+{
+	bg->ref_count++;
+	return bg;
+}
+
 static void
 background_unref (Background** bg)
 {
@@ -192,8 +302,44 @@ background_unref (Background** bg)
 	(*bg)->ref_count--;
 	if ((*bg)->ref_count == 0) {
 		background_finalize (*bg);
-		*bg = NULL;
+		g_free (*bg);
 	}
+	*bg = NULL;
+}
+
+static void
+background_load_target_free (BackgroundLoadTarget* target)
+{
+	g_clear_pointer (&target->image, cairo_surface_destroy);
+	g_free (target);
+}
+
+static BackgroundLoadData*
+background_load_data_new (const gchar* path)
+{
+	BackgroundLoadData* data = g_new0 (BackgroundLoadData, 1);
+
+	data->path = g_strdup (path);
+	data->targets = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                           (GDestroyNotify) background_load_target_free);
+	data->sources = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+	g_mutex_init (&data->sources_lock);
+	g_mutex_init (&data->preview_lock);
+	data->start_time = g_get_monotonic_time ();
+
+	return data;
+}
+
+static void
+background_load_data_free (BackgroundLoadData* data)
+{
+	g_mutex_clear (&data->preview_lock);
+	g_clear_object (&data->preview);
+	g_mutex_clear (&data->sources_lock);
+	g_hash_table_unref (data->sources);
+	g_hash_table_unref (data->targets);
+	g_free (data->path);
+	g_free (data);
 }
 
 static void
@@ -203,6 +349,7 @@ background_config_finalize (BackgroundConfig* config)
 	{
 		case BACKGROUND_TYPE_IMAGE:
 			g_free (config->options.image.path);
+			g_strfreev (config->options.image.slides);
 			break;
 		case BACKGROUND_TYPE_COLOR:
 			break;
@@ -222,21 +369,29 @@ monitor_config_free (MonitorConfig* config)
 }
 
  
+/* Drops the background with the slides around it */
+static void
+monitor_clear_background (Monitor* monitor)
+{
+	if (monitor->transition_tick_id)
+		gtk_widget_remove_tick_callback (GTK_WIDGET (monitor->window), monitor->transition_tick_id);
+	monitor->transition_tick_id = 0;
+
+	background_unref (&monitor->previous_background);
+	background_unref (&monitor->next_background);
+	background_unref (&monitor->background);
+}
+
 static void
 monitor_finalize (Monitor* monitor)
 {
 	if (monitor->window_draw_handler_id)
 		g_signal_handler_disconnect (monitor->window, monitor->window_draw_handler_id);
 
-	background_unref (&monitor->background);
+	monitor_clear_background (monitor);
 
-	if (monitor->window) {
-		GtkWidget* child = gtk_bin_get_child (GTK_BIN (monitor->window));
-		if (child) { /* remove greeter widget to avoid "destroy" signal */
-			gtk_container_remove (GTK_CONTAINER (monitor->window), child);
-		}
+	if (monitor->window)
 		gtk_widget_destroy (GTK_WIDGET (monitor->window));
-	}
 
 	g_free (monitor->name);
 
@@ -252,6 +407,7 @@ background_config_copy (const BackgroundConfig* source, BackgroundConfig* dest)
 	{
 		case BACKGROUND_TYPE_IMAGE:
 			dest->options.image.path = g_strdup (source->options.image.path);
+			dest->options.image.slides = g_strdupv (source->options.image.slides);
 			break;
 		case BACKGROUND_TYPE_COLOR:
 			break;
@@ -272,107 +428,10 @@ monitor_config_copy (const MonitorConfig* source,
 	return dest;
 }
 
-static GdkPixbuf*
-scale_image (GdkPixbuf* source, ScalingMode mode, gint width, gint height)
-{
-	if(mode == SCALING_MODE_ZOOMED) {
-		gint offset_x = 0;
-		gint offset_y = 0;
-		gint p_width = gdk_pixbuf_get_width(source);
-		gint p_height = gdk_pixbuf_get_height(source);
-		gdouble scale_x = (gdouble)width / p_width;
-		gdouble scale_y = (gdouble)height / p_height;
-
-		if(scale_x < scale_y) {
-			scale_x = scale_y;
-			offset_x = (width - (p_width * scale_x)) / 2;
-		} else {
-			scale_y = scale_x;
-			offset_y = (height - (p_height * scale_y)) / 2;
-		}
-
-		GdkPixbuf *pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE,
-                                            gdk_pixbuf_get_bits_per_sample (source),
-                                            width, height);
-		gdk_pixbuf_composite (source, pixbuf, 0, 0, width, height,
-                              offset_x, offset_y, scale_x, scale_y, GDK_INTERP_BILINEAR, 0xFF);
-		return pixbuf;
-	}
-
-	if (mode == SCALING_MODE_SCALED) {
-		gdouble factor;
-		gint p_width, p_height;
-		gint new_width, new_height;
-		gint offset_x, offset_y;
-
-		p_width = gdk_pixbuf_get_width (source);
-		p_height = gdk_pixbuf_get_height (source);
-
-		factor = MIN (width/(gdouble)p_width, height/(gdouble)p_height);
-
-		offset_x = (width - (p_width * factor)) / 2;
-		offset_y = (height - (p_height * factor)) / 2;
-
-		new_width  = floor (p_width * factor + 0.5);
-		new_height = floor (p_height * factor + 0.5);
-
-		GdkPixbuf *new = gdk_pixbuf_scale_simple (source, new_width, new_height, GDK_INTERP_BILINEAR);
-
-		GdkPixbuf *pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE,
-                                            gdk_pixbuf_get_bits_per_sample (source),
-                                            width, height);
-
-		gdk_pixbuf_composite (new, pixbuf, offset_x, offset_y, new_width, new_height,
-                              offset_x, offset_y, 1.0, 1.0, GDK_INTERP_NEAREST, 0xFF);
-
-		g_object_unref (new);
-
-		return pixbuf;
-	}
-
-	if (mode == SCALING_MODE_STRETCHED)
-		return gdk_pixbuf_scale_simple (source, width, height, GDK_INTERP_BILINEAR);
-
-	return GDK_PIXBUF (g_object_ref (source));
-}
-
-static GdkPixbuf*
-scale_image_file (const gchar* path, ScalingMode mode, gint width, gint height, GHashTable* cache)
+static gchar*
+image_key (const gchar* path, ScalingMode mode, gint width, gint height, gint scale)
 {
-	gchar* key = NULL;
-	GdkPixbuf* pixbuf = NULL;
-
-	if (cache) {
-		key = g_strdup_printf ("%s\n%d %dx%d", path, mode, width, height);
-		if (g_hash_table_lookup_extended (cache, key, NULL, (gpointer*)&pixbuf)) {
-			g_free (key);
-			return GDK_PIXBUF (g_object_ref (pixbuf));
-		}
-	}
-
-	if (!cache || !g_hash_table_lookup_extended (cache, path, NULL, (gpointer*)&pixbuf)) {
-		GError *error = NULL;
-		pixbuf = gdk_pixbuf_new_from_file (path, &error);
-		if (error) {
-			g_warning ("[Background] Failed to load background: %s", error->message);
-			g_clear_error (&error);
-		} else if (cache)
-			g_hash_table_insert (cache, g_strdup (path), g_object_ref (pixbuf));
-	} else {
-		pixbuf = g_object_ref (pixbuf);
-	}
-
-	if(pixbuf) {
-		GdkPixbuf* scaled = scale_image (pixbuf, mode, width, height);
-		if(cache)
-			g_hash_table_insert (cache, g_strdup(key), g_object_ref(scaled));
-		g_object_unref (pixbuf);
-		pixbuf = scaled;
-	}
-
-	g_free(key);
-
-	return pixbuf;
+	return g_strdup_printf ("%s\n%d %dx%d@%d", path, mode, width, height, scale);
 }
 
 static void
@@ -402,14 +461,6 @@ greeter_background_set_cursor_position (GreeterBackground* background, gint x, g
 	gdk_device_warp (pointer, priv->screen, x, y);
 }
 
-static void
-greeter_background_monitors_changed_cb (GdkScreen* screen, GreeterBackground* background)
-{
-	g_return_if_fail (GREETER_IS_BACKGROUND (background));
-
-	greeter_background_connect (background, screen);
-}
-
 //static void
 //greeter_background_child_destroyed_cb (GtkWidget* child, GreeterBackground* background)
 //{
@@ -417,30 +468,113 @@ greeter_background_monitors_changed_cb (GdkScreen* screen, GreeterBackground* ba
 //	background->priv->child = NULL;
 //}
 
+static cairo_surface_t*
+background_get_surface (Background* background,
+                        GdkWindow*  window)
+{
+	cairo_t* cr;
+	gint width, height;
+	gdouble scale_x, scale_y;
+
+	if (background->surface)
+		return background->surface;
+
+	if (!background->options.image || !window)
+		return NULL;
+
+	/* Image is in device pixels with a device scale, similar surface takes logical size */
+	cairo_surface_get_device_scale (background->options.image, &scale_x, &scale_y);
+	width = cairo_image_surface_get_width (background->options.image) / scale_x;
+	height = cairo_image_surface_get_height (background->options.image) / scale_y;
+
+	/* Convert the image once; further draws only copy the damaged area */
+	background->surface = gdk_window_create_similar_surface (window, CAIRO_CONTENT_COLOR, width, height);
+
+	cr = cairo_create (background->surface);
+	cairo_set_source_surface (cr, background->options.image, 0, 0);
+	cairo_paint (cr);
+	cairo_destroy (cr);
+
+	return background->surface;
+}
+
+/* Position of the monitor in the background image, non-zero for spanned images only */
 static void
-monitor_draw_background (const Monitor* monitor,
-                         const Background* background,
-                         cairo_t* cr)
+monitor_get_background_offset (const Monitor*    monitor,
+                               const Background* background,
+                               gint*             x,
+                               gint*             y)
 {
-	g_return_if_fail (monitor != NULL);
-	g_return_if_fail (background != NULL);
+	*x = background->spanned ? monitor->geometry.x - background->area.x : 0;
+	*y = background->spanned ? monitor->geometry.y - background->area.y : 0;
+}
+
+/* Image, preview while loading or color of the background */
+static gboolean
+monitor_set_background_source (const Monitor* monitor,
+                               Background* background,
+                               cairo_t* cr)
+{
+	gint offset_x, offset_y;
+	cairo_surface_t* surface;
 
 	switch(background->type)
 	{
 		case BACKGROUND_TYPE_IMAGE:
-			if(background->options.image) {
-				gdk_cairo_set_source_pixbuf(cr, background->options.image, 0, 0);
-				cairo_paint(cr);
+			surface = background_get_surface (background, gtk_widget_get_window (GTK_WIDGET (monitor->window)));
+			if (!surface) /* Still loading */
+				surface = background->preview;
+			if (surface) {
+				monitor_get_background_offset (monitor, background, &offset_x, &offset_y);
+				cairo_set_source_surface (cr, surface, -offset_x, -offset_y);
+			} else {
+				gdk_cairo_set_source_rgba (cr, &monitor->object->priv->placeholder_color);
 			}
-			break;
+			return TRUE;
 		case BACKGROUND_TYPE_COLOR:
-			cairo_rectangle (cr, 0, 0, monitor->geometry.width, monitor->geometry.height);
 			gdk_cairo_set_source_rgba (cr, &background->options.color);
-			cairo_fill(cr);
-			break;
+			return TRUE;
 		case BACKGROUND_TYPE_INVALID:
-			g_return_if_reached();
+			g_return_val_if_reached (FALSE);
 	}
+
+	return FALSE;
+}
+
+static void
+monitor_draw_background (const Monitor* monitor,
+                         Background* background,
+                         cairo_t* cr)
+{
+	gdouble x1, y1, x2, y2;
+
+	g_return_if_fail (monitor != NULL);
+	g_return_if_fail (background != NULL);
+
+	/* Only repaint the damaged region */
+	cairo_clip_extents (cr, &x1, &y1, &x2, &y2);
+
+	cairo_save (cr);
+	cairo_rectangle (cr, x1, y1, x2 - x1, y2 - y1);
+	cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+
+	if (monitor_set_background_source (monitor, background, cr))
+		cairo_fill (cr);
+
+	cairo_restore (cr);
+}
+
+/* Slideshow crossfade: the new slide is blended over the previous one */
+static void
+monitor_draw_transition (const Monitor* monitor,
+                         cairo_t* cr)
+{
+	monitor_draw_background (monitor, monitor->previous_background, cr);
+
+	cairo_save (cr);
+	if (monitor_set_background_source (monitor, monitor->background, cr))
+		cairo_paint_with_alpha (cr, monitor->transition_progress);
+	cairo_restore (cr);
 }
 
 static gboolean
@@ -451,377 +585,1761 @@ monitor_window_draw_cb (GtkWidget* widget,
 	if (!monitor->background)
 		return FALSE;
 
-	monitor_draw_background (monitor, monitor->background, cr);
+	if (monitor->previous_background)
+		monitor_draw_transition (monitor, cr);
+	else
+		monitor_draw_background (monitor, monitor->background, cr);
 
 	return FALSE;
 }
 
-static gboolean
-background_config_initialize (BackgroundConfig* config, const gchar* value)
+/* Sets the background as window attribute, so exposures are handled by the
+   X server and GDK clears paint buffers from the pixmap without client draws */
+static void
+window_set_background (GtkWindow* widget, const Monitor* monitor)
 {
-	config->type = BACKGROUND_TYPE_INVALID;
-
-	if (!value || strlen (value) == 0)
-		return FALSE;
-
-	if (gdk_rgba_parse (&config->options.color, value)) {
-		config->type = BACKGROUND_TYPE_COLOR;
-    } else {
-		const gchar** prefix = SCALING_MODE_PREFIXES;
-		while (*prefix && !g_str_has_prefix (value, *prefix))
-			++prefix;
-
-		if (*prefix) {
-			config->options.image.mode = (ScalingMode)(prefix - SCALING_MODE_PREFIXES);
-			value += strlen (*prefix);
-		} else {
-			config->options.image.mode = SCALING_MODE_ZOOMED;
-		}
-
-		config->options.image.path = g_strdup (value);
-		config->type = BACKGROUND_TYPE_IMAGE;
-	}
+	GdkWindow* window;
+	cairo_surface_t* surface;
+	cairo_pattern_t* pattern;
 
-	return TRUE;
-}
-
-static Background*
-background_new (const BackgroundConfig* config, const Monitor* monitor, GHashTable* images_cache)
-{
-	Background bg = {0};
+	window = gtk_widget_get_window (GTK_WIDGET (widget));
+	if (!window || !monitor->background)
+		return;
 
-	switch (config->type)
+	G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+	switch (monitor->background->type)
 	{
 		case BACKGROUND_TYPE_IMAGE:
-			bg.options.image = scale_image_file (config->options.image.path,
-                                                 config->options.image.mode,
-                                                 monitor->geometry.width,
-                                                 monitor->geometry.height,
-                                                 images_cache);
-			if (!bg.options.image) {
-				g_warning ("[Background] Failed to read wallpaper: %s", config->options.image.path);
-				return NULL;
+			/* Similar surface of X11 window is a pixmap on the server side */
+			surface = background_get_surface (monitor->background, window);
+			/* Preview is a client-side image, it is only shown while loading */
+			if (!surface)
+				surface = monitor->background->preview;
+			if (surface) {
+				cairo_matrix_t matrix;
+				gint offset_x, offset_y;
+
+				/* Spanned image: view into the shared pixmap. GDK can only hand
+				   untransformed patterns to the server, others are cleared client-side. */
+				pattern = cairo_pattern_create_for_surface (surface);
+				monitor_get_background_offset (monitor, monitor->background, &offset_x, &offset_y);
+				cairo_matrix_init_translate (&matrix, offset_x, offset_y);
+				cairo_pattern_set_matrix (pattern, &matrix);
+				gdk_window_set_background_pattern (window, pattern);
+				cairo_pattern_destroy (pattern);
+			} else { /* Still loading */
+				gdk_window_set_background_rgba (window, &monitor->object->priv->placeholder_color);
 			}
 			break;
 		case BACKGROUND_TYPE_COLOR:
-			bg.options.color = config->options.color;
+			/* Plain background pixel */
+			gdk_window_set_background_rgba (window, &monitor->background->options.color);
 			break;
 		case BACKGROUND_TYPE_INVALID:
-			g_return_val_if_reached (NULL);
+			break;
 	}
+	G_GNUC_END_IGNORE_DEPRECATIONS
 
-	bg.type = config->type;
-	bg.ref_count = 1;
+	gtk_widget_queue_draw (GTK_WIDGET (widget));
+}
 
-	Background* result = g_new (Background, 1);
-	*result = bg;
+static void
+window_apply_geometry (GtkWindow* window, const GdkRectangle* geometry)
+{
+	gtk_widget_set_size_request (GTK_WIDGET (window), geometry->width, geometry->height);
+	gtk_window_move (window, geometry->x, geometry->y);
+	gtk_window_resize (window, geometry->width, geometry->height);
+}
 
-	return result;
+static void
+monitor_set_window_background (Monitor* monitor)
+{
+	window_set_background (monitor->window, monitor);
 }
 
+/* Box blur of one row or column, "step" bytes between pixels */
 static void
-greeter_background_disconnect (GreeterBackground* background)
+image_blur_line (guchar* pixels, gint step, gint length, gint radius, guchar* line)
 {
-	g_return_if_fail (GREETER_IS_BACKGROUND (background));
-	GreeterBackgroundPrivate* priv = background->priv;
+	gint i, c;
 
-	if (priv->monitors_changed_handler_id)
-		g_signal_handler_disconnect (priv->screen, priv->monitors_changed_handler_id);
-	priv->monitors_changed_handler_id = 0;
-	priv->screen = NULL;
-	priv->active_monitor = NULL;
+	for (i = 0; i < length; ++i)
+		memcpy (line + i * 4, pixels + i * step, 4);
 
-	gint i;
-	for (i = 0; i < priv->monitors_size; ++i)
-		monitor_finalize (&priv->monitors[i]);
+	for (c = 0; c < 4; ++c) {
+		guint sum = 0;
 
-	g_free (priv->monitors);
-	priv->monitors = NULL;
-	priv->monitors_size = 0;
+		for (i = -radius; i <= radius; ++i)
+			sum += line[CLAMP (i, 0, length - 1) * 4 + c];
 
-	g_hash_table_unref (priv->monitors_map);
-	priv->monitors_map = NULL;
+		for (i = 0; i < length; ++i) {
+			pixels[i * step + c] = sum / (2 * radius + 1);
+			sum += line[MIN (i + radius + 1, length - 1) * 4 + c];
+			sum -= line[MAX (i - radius, 0) * 4 + c];
+		}
+	}
 }
 
+/* Three box passes per axis approximate a gaussian blur */
 static void
-greeter_background_set_active_monitor (GreeterBackground* background, const Monitor* active)
+image_blur (cairo_surface_t* image, gint radius)
 {
-	GreeterBackgroundPrivate* priv = background->priv;
-
-	if (active && !active->background) {
-		if (priv->active_monitor)
-			return;
-
-		active = NULL;
+	gint pass, i;
+	guchar* line;
+	guchar* data = cairo_image_surface_get_data (image);
+	gint stride = cairo_image_surface_get_stride (image);
+	gint width = cairo_image_surface_get_width (image);
+	gint height = cairo_image_surface_get_height (image);
+
+	cairo_surface_flush (image);
+	line = g_new (guchar, MAX (width, height) * 4);
+
+	for (pass = 0; pass < 3; ++pass) {
+		for (i = 0; i < height; ++i)
+			image_blur_line (data + i * stride, 4, width, radius, line);
+		for (i = 0; i < width; ++i)
+			image_blur_line (data + i * 4, stride, height, radius, line);
 	}
 
-    /* Auto */
-	if (!active) {
-		/* Using primary monitor */
-		if (!active) {
-			gint i;
-			GdkDisplay *display;
+	g_free (line);
+	cairo_surface_mark_dirty (image);
+}
 
-			display = gdk_display_get_default ();
+/* Active monitor background with the child backdrop (theme color
+ * "greeter_window_bg_color", optionally blurred) composited in once,
+ * so panel redraws are plain copies instead of alpha blending */
+static cairo_surface_t*
+greeter_background_get_panel_backdrop (GreeterBackground* background)
+{
+	cairo_t* cr;
+	gint scale;
+	GdkRGBA color;
+	GdkWindow* window;
+	GdkRectangle area, blur_area, bounds;
+	GreeterBackgroundPrivate* priv = background->priv;
+	const Monitor* active = priv->active_monitor;
+	gint64 start_time = g_get_monotonic_time ();
 
-			for (i = 0; i < priv->monitors_size; i++) {
-				GdkMonitor *gdk_monitor = gdk_display_get_monitor (display, i);
-				if (gdk_monitor_is_primary (gdk_monitor)) {
-					active = &priv->monitors[i];
-					break;
-				}
-			}
+	if (priv->panel_backdrop_blur < 0 || !priv->child || !active || !active->background)
+		return NULL;
 
-			if (!active->background)
-				active = NULL;
-			if (active)
-				g_debug ("[Background] Active monitor is not specified, using primary monitor");
-		}
+	window = gtk_widget_get_window (GTK_WIDGET (priv->panel_window));
+	if (!window)
+		return NULL;
 
-		/* Fallback: first enabled and/or not skipped monitor (screen always have one) */
-		if (!active) {
-			gint i;
-			for (i = 0; i < priv->monitors_size; i++) {
-				const Monitor* monitor = &priv->monitors[i];
-				if (monitor->background) {
-					active = monitor;
-					break;
-				}
-			}
-			if (active)
-				g_debug ("[Background] Active monitor is not specified, using first enabled monitor");
-		}
+	gtk_widget_get_allocation (priv->child, &area);
+	if (priv->panel_backdrop && gdk_rectangle_equal (&area, &priv->panel_backdrop_area))
+		return priv->panel_backdrop;
+
+	g_clear_pointer (&priv->panel_backdrop, cairo_surface_destroy);
+	priv->panel_backdrop_area = area;
+
+	if (!gtk_style_context_lookup_color (gtk_widget_get_style_context (priv->child),
+                                         "greeter_window_bg_color", &color))
+		color.alpha = 0.0;
+
+	/* Composited server side, like monitor backgrounds are kept */
+	priv->panel_backdrop = gdk_window_create_similar_surface (window, CAIRO_CONTENT_COLOR,
+                                                              active->geometry.width,
+                                                              active->geometry.height);
+	cr = cairo_create (priv->panel_backdrop);
+	monitor_draw_background (active, active->background, cr);
+
+	bounds = (GdkRectangle) {0, 0, active->geometry.width, active->geometry.height};
+	if (priv->panel_backdrop_blur > 0 && gdk_rectangle_intersect (&area, &bounds, &blur_area)) {
+		cairo_t* image_cr;
+		cairo_surface_t* image;
+
+		/* Only the area under the child is read back and blurred */
+		scale = active->scale;
+		image = cairo_image_surface_create (CAIRO_FORMAT_RGB24, blur_area.width * scale, blur_area.height * scale);
+		cairo_surface_set_device_scale (image, scale, scale);
+
+		image_cr = cairo_create (image);
+		cairo_set_source_surface (image_cr, priv->panel_backdrop, -blur_area.x, -blur_area.y);
+		cairo_paint (image_cr);
+		cairo_destroy (image_cr);
+
+		image_blur (image, priv->panel_backdrop_blur * scale);
+
+		cairo_set_source_surface (cr, image, blur_area.x, blur_area.y);
+		gdk_cairo_rectangle (cr, &blur_area);
+		cairo_fill (cr);
+		cairo_surface_destroy (image);
 	}
 
-	if (!active) {
-		if (priv->active_monitor)
-			g_warning ("[Background] Active monitor is not specified, failed to identify. Active monitor stays the same: %s #%d", priv->active_monitor->name, priv->active_monitor->number);
-		else
-			g_warning ("[Background] Active monitor is not specified, failed to identify. Active monitor stays the same: <not defined>");
-		return;
-	}
+	gdk_cairo_rectangle (cr, &area);
+	gdk_cairo_set_source_rgba (cr, &color);
+	cairo_fill (cr);
+	cairo_destroy (cr);
 
-	if (active == priv->active_monitor)
-		return;
+	g_debug ("[Background] Panel backdrop composited in %.1f ms",
+             (g_get_monotonic_time () - start_time) / 1000.0);
 
-	priv->active_monitor = active;
+	return priv->panel_backdrop;
+}
 
-	g_return_if_fail (priv->active_monitor != NULL);
+static gboolean
+panel_window_draw_cb (GtkWidget* widget,
+                      cairo_t* cr,
+                      GreeterBackground* background)
+{
+	GreeterBackgroundPrivate* priv = background->priv;
+	const Monitor* active = priv->active_monitor;
+	cairo_surface_t* backdrop;
 
-	if (priv->child) {
-		GtkWidget* old_parent = gtk_widget_get_parent(priv->child);
-		gpointer focus = greeter_save_focus (priv->child);
-		if (old_parent) {
-			gtk_container_remove (GTK_CONTAINER (old_parent), priv->child);
+	if (!active || !active->background)
+		return FALSE;
+
+	/* Crossfade is painted around the child only, the child area switches
+	 * when it is over, so login entries are not redrawn on every frame */
+	if (active->previous_background) {
+		GdkRectangle area = {0};
+
+		if (priv->child)
+			gtk_widget_get_allocation (priv->child, &area);
+
+		cairo_save (cr);
+		gdk_cairo_rectangle (cr, &area);
+		cairo_clip (cr);
+		if (priv->panel_backdrop) {
+			cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+			cairo_set_source_surface (cr, priv->panel_backdrop, 0, 0);
+			cairo_paint (cr);
+		} else {
+			monitor_draw_background (active, active->previous_background, cr);
 		}
+		cairo_restore (cr);
 
-		gtk_container_add (GTK_CONTAINER (active->window), priv->child);
-		gtk_window_present (active->window);
-		greeter_restore_focus (focus);
-		g_free (focus);
-	} else {
-		g_warning ("[Background] Child widget is destroyed or not defined");
+		cairo_save (cr);
+		cairo_set_fill_rule (cr, CAIRO_FILL_RULE_EVEN_ODD);
+		cairo_rectangle (cr, 0, 0, active->geometry.width, active->geometry.height);
+		gdk_cairo_rectangle (cr, &area);
+		cairo_clip (cr);
+		monitor_draw_transition (active, cr);
+		cairo_restore (cr);
+
+		return FALSE;
 	}
 
+	backdrop = greeter_background_get_panel_backdrop (background);
+	if (backdrop) {
+		cairo_save (cr);
+		cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+		cairo_set_source_surface (cr, backdrop, 0, 0);
+		cairo_paint (cr);
+		cairo_restore (cr);
+	} else {
+		monitor_draw_background (active, active->background, cr);
+	}
+
+	return FALSE;
+}
+
+/* Panel window shows the background of the monitor below it */
+static void
+greeter_background_update_panel_background (GreeterBackground* background)
+{
+	GreeterBackgroundPrivate* priv = background->priv;
+	cairo_surface_t* backdrop;
+	cairo_pattern_t* pattern;
+	GdkWindow* window;
+
+	if (!priv->panel_window || !priv->active_monitor)
+		return;
+
+	/* Active monitor, its background or the panel geometry has changed */
+	g_clear_pointer (&priv->panel_backdrop, cairo_surface_destroy);
+
+	if (!priv->use_pixmap) {
+		gtk_widget_queue_draw (GTK_WIDGET (priv->panel_window));
+		return;
+	}
+
+	backdrop = greeter_background_get_panel_backdrop (background);
+	window = gtk_widget_get_window (GTK_WIDGET (priv->panel_window));
+	if (!backdrop || !window) {
+		window_set_background (priv->panel_window, priv->active_monitor);
+		return;
+	}
+
+	G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+	pattern = cairo_pattern_create_for_surface (backdrop);
+	gdk_window_set_background_pattern (window, pattern);
+	cairo_pattern_destroy (pattern);
+	G_GNUC_END_IGNORE_DEPRECATIONS
+	gtk_widget_queue_draw (GTK_WIDGET (priv->panel_window));
+}
+
+static void
+panel_window_size_allocate_cb (GtkWidget*         widget,
+                               GdkRectangle*      allocation,
+                               GreeterBackground* background)
+{
+	GreeterBackgroundPrivate* priv = background->priv;
+	GdkRectangle area;
+
+	if (!priv->panel_backdrop)
+		return;
+
+	/* Backdrop follows the child */
+	gtk_widget_get_allocation (priv->child, &area);
+	if (!gdk_rectangle_equal (&area, &priv->panel_backdrop_area))
+		greeter_background_update_panel_background (background);
+}
+
+static void
+monitor_update_background (Monitor* monitor)
+{
+	if (!monitor->window)
+		return;
+
+	if (monitor->object->priv->use_pixmap)
+		monitor_set_window_background (monitor);
+	else
+		gtk_widget_queue_draw (GTK_WIDGET (monitor->window));
+
+	if (monitor == monitor->object->priv->active_monitor)
+		greeter_background_update_panel_background (monitor->object);
+}
+
+/* Crossfade frame on the active monitor: its window is covered by the panel,
+ * and the child area of the panel keeps the previous slide */
+static void
+panel_window_invalidate_transition (GreeterBackground* background)
+{
+	GreeterBackgroundPrivate* priv = background->priv;
+	cairo_region_t* region;
+	GdkRectangle area;
+	GdkWindow* window;
+
+	window = gtk_widget_get_window (GTK_WIDGET (priv->panel_window));
+	if (!window)
+		return;
+
+	area = (GdkRectangle) {0, 0, gdk_window_get_width (window), gdk_window_get_height (window)};
+	region = cairo_region_create_rectangle (&area);
+	if (priv->child) {
+		gtk_widget_get_allocation (priv->child, &area);
+		cairo_region_subtract_rectangle (region, &area);
+	}
+
+	gdk_window_invalidate_region (window, region, FALSE);
+	cairo_region_destroy (region);
+}
+
+static void
+monitor_end_transition (Monitor* monitor)
+{
+	background_unref (&monitor->previous_background);
+	monitor_update_background (monitor);
+
+	greeter_background_slideshow_schedule (monitor->object);
+}
+
+static gboolean
+monitor_transition_tick_cb (GtkWidget*     widget,
+                            GdkFrameClock* frame_clock,
+                            gpointer       user_data)
+{
+	Monitor* monitor = user_data;
+	gint64 frame_time = gdk_frame_clock_get_frame_time (frame_clock);
+	gdouble progress;
+
+	if (!monitor->transition_start)
+		monitor->transition_start = frame_time;
+
+	progress = (frame_time - monitor->transition_start) / (SLIDESHOW_TRANSITION_DURATION * 1000.0);
+	if (progress >= 1.0) {
+		monitor->transition_tick_id = 0;
+		monitor_end_transition (monitor);
+		return G_SOURCE_REMOVE;
+	}
+
+	/* Smoothstep */
+	monitor->transition_progress = progress * progress * (3.0 - 2.0 * progress);
+
+	if (monitor == monitor->object->priv->active_monitor)
+		panel_window_invalidate_transition (monitor->object);
+	else
+		gtk_widget_queue_draw (widget);
+
+	return G_SOURCE_CONTINUE;
+}
+
+/* Shows the next slide, crossfading when windows are painted by the greeter */
+static void
+monitor_start_transition (Monitor* monitor, Background* next)
+{
+	Background* previous = monitor->background;
+
+	monitor->background = next;
+
+	if (monitor->object->priv->use_pixmap || !previous ||
+	    !gtk_widget_get_mapped (GTK_WIDGET (monitor->window))) {
+		background_unref (&previous);
+		monitor_update_background (monitor);
+		return;
+	}
+
+	monitor->previous_background = previous;
+	monitor->transition_progress = 0.0;
+	monitor->transition_start = 0;
+	monitor->transition_tick_id = gtk_widget_add_tick_callback (GTK_WIDGET (monitor->window),
+                                                                monitor_transition_tick_cb,
+                                                                monitor, NULL);
+}
+
+static gboolean
+background_config_initialize (BackgroundConfig* config, const gchar* value)
+{
+	config->type = BACKGROUND_TYPE_INVALID;
+
+	if (!value || strlen (value) == 0)
+		return FALSE;
+
+	if (gdk_rgba_parse (&config->options.color, value)) {
+		config->type = BACKGROUND_TYPE_COLOR;
+    } else {
+		value = image_parse_scaling_mode (value, &config->options.image.mode);
+		config->options.image.slides = image_list_slides (value);
+		config->type = BACKGROUND_TYPE_IMAGE;
+
+		/* First slide is shown until the slideshow starts */
+		if (config->options.image.slides && config->options.image.slides[0])
+			config->options.image.path = g_strdup (config->options.image.slides[0]);
+		else
+			config->options.image.path = g_strdup (value);
+
+		if (config->options.image.slides && g_strv_length (config->options.image.slides) < 2)
+			g_clear_pointer (&config->options.image.slides, g_strfreev);
+	}
+
+	return TRUE;
+}
+
+/* Config of one slide, FALSE (and a plain copy) if it is not a slideshow */
+static gboolean
+background_config_get_slide (const BackgroundConfig* config,
+                             guint                   index,
+                             BackgroundConfig*       slide)
+{
+	gchar** slides;
+
+	*slide = *config;
+
+	if (config->type != BACKGROUND_TYPE_IMAGE || !config->options.image.slides)
+		return FALSE;
+
+	slides = config->options.image.slides;
+	slide->options.image.path = slides[index % g_strv_length (slides)];
+
+	return TRUE;
+}
+
+static Background*
+background_new (const BackgroundConfig* config, const Monitor* monitor)
+{
+	Background bg = {0};
+
+	switch (config->type)
+	{
+		case BACKGROUND_TYPE_IMAGE:
+			/* Spanned image is shared by all monitors, each one paints its own part */
+			bg.spanned = config->options.image.mode == SCALING_MODE_SPANNED;
+			bg.area = bg.spanned ? monitor->object->priv->screen_geometry : monitor->geometry;
+
+			/* Image is loaded by background_load_thread() */
+			bg.key = image_key (config->options.image.path,
+                                config->options.image.mode,
+                                bg.area.width * monitor->scale,
+                                bg.area.height * monitor->scale,
+                                monitor->scale);
+			break;
+		case BACKGROUND_TYPE_COLOR:
+			bg.options.color = config->options.color;
+			bg.area = monitor->geometry;
+			break;
+		case BACKGROUND_TYPE_INVALID:
+			g_return_val_if_reached (NULL);
+	}
+
+	bg.type = config->type;
+	bg.ref_count = 1;
+
+	Background* result = g_new (Background, 1);
+	*result = bg;
+
+	return result;
+}
+
+/* User and system time of the whole process, in microseconds */
+static gint64
+get_process_cpu_time (void)
+{
+	struct rusage usage;
+
+	if (getrusage (RUSAGE_SELF, &usage) != 0)
+		return 0;
+
+	return (gint64) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * G_USEC_PER_SEC +
+	       usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+/* Preview image passed from a pool thread to the main loop */
+typedef struct
+{
+	GreeterBackground* background;
+	GCancellable* cancellable;
+	gchar* key;
+	cairo_surface_t* image;
+	gint64 start_time;
+} BackgroundPreview;
+
+static void
+background_preview_free (BackgroundPreview* preview)
+{
+	g_object_unref (preview->background);
+	g_clear_object (&preview->cancellable);
+	g_free (preview->key);
+	cairo_surface_destroy (preview->image);
+	g_free (preview);
+}
+
+static gboolean
+background_preview_ready_cb (BackgroundPreview* preview)
+{
+	gint i;
+	GreeterBackgroundPrivate* priv = preview->background->priv;
+
+	if (g_cancellable_is_cancelled (preview->cancellable))
+		return G_SOURCE_REMOVE;
+
+	for (i = 0; i < priv->monitors_size; ++i) {
+		Monitor* monitor = &priv->monitors[i];
+		Background* bg = monitor->background;
+
+		/* Too late, image is already loaded */
+		if (!bg || bg->options.image || g_strcmp0 (bg->key, preview->key) != 0)
+			continue;
+
+		if (!bg->preview)
+			bg->preview = cairo_surface_reference (preview->image);
+
+		monitor_update_background (monitor);
+	}
+
+	g_debug ("[Background] Preview shown after %.1f ms: %s",
+             (g_get_monotonic_time () - preview->start_time) / 1000.0, preview->key);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Shows scaled preview of the source until the target image is ready */
+static void
+background_load_target_preview (BackgroundLoadTarget* target,
+                                GTask*                task)
+{
+	BackgroundLoadData* data = target->data;
+	BackgroundPreview* preview;
+	GdkPixbuf* source;
+	GdkPixbuf* pixbuf;
+
+	g_mutex_lock (&data->preview_lock);
+	if (!data->preview_loaded) {
+		data->preview = image_load_preview (data->path, target->mode, target->width, target->height);
+		data->preview_loaded = TRUE;
+	}
+	source = data->preview ? g_object_ref (data->preview) : NULL;
+	g_mutex_unlock (&data->preview_lock);
+
+	if (!source)
+		return;
+
+	pixbuf = image_scale (source, target->mode, target->width, target->height, SCALER_FILTER_BILINEAR);
+	g_object_unref (source);
+
+	if (!pixbuf)
+		return;
+
+	preview = g_new0 (BackgroundPreview, 1);
+	preview->background = g_object_ref (g_task_get_source_object (task));
+	preview->cancellable = g_task_get_cancellable (task) ? g_object_ref (g_task_get_cancellable (task)) : NULL;
+	preview->key = g_strdup (target->key);
+	preview->image = image_surface_from_pixbuf (pixbuf, target->scale);
+	preview->start_time = data->start_time;
+	g_object_unref (pixbuf);
+
+	g_idle_add_full (G_PRIORITY_DEFAULT, (GSourceFunc) background_preview_ready_cb,
+                     preview, (GDestroyNotify) background_preview_free);
+}
+
+static void
+background_load_target_prepare (BackgroundLoadTarget* target,
+                                GTask*                task)
+{
+	BackgroundLoadData* data = target->data;
+	GCancellable* cancellable = g_task_get_cancellable (task);
+	GdkPixbuf* source;
+	GdkPixbuf* pixbuf;
+	cairo_surface_t* shared;
+	BackgroundCacheLock* lock;
+	gint64 start_time = g_get_monotonic_time ();
+
+	if (g_cancellable_is_cancelled (cancellable))
+		return;
+
+	target->image = background_cache_lookup (data->path, target->mode, target->filter,
+                                             target->width, target->height, target->scale);
+	if (target->image)
+		return;
+
+	/* Prefetched slides are not shown before they are ready */
+	if (g_task_get_priority (task) <= G_PRIORITY_DEFAULT)
+		background_load_target_preview (target, task);
+
+	/* Another greeter process may be preparing the same image */
+	lock = background_cache_lock (data->path, target->mode, target->filter,
+                                  target->width, target->height, target->scale);
+	if (lock) {
+		target->image = background_cache_lookup (data->path, target->mode, target->filter,
+                                                 target->width, target->height, target->scale);
+		if (target->image) {
+			background_cache_unlock (lock);
+			return;
+		}
+	}
+
+	/* First target decodes the source, others with the same path wait and share it */
+	g_mutex_lock (&data->sources_lock);
+	source = image_load_file (data->path, target->mode, target->width, target->height, data->sources);
+	g_mutex_unlock (&data->sources_lock);
+
+	if (!source) {
+		background_cache_unlock (lock);
+		return;
+	}
+
+	if (g_cancellable_is_cancelled (cancellable)) {
+		background_cache_unlock (lock);
+		g_object_unref (source);
+		return;
+	}
+
+	pixbuf = image_scale (source, target->mode, target->width, target->height, target->filter);
+	g_object_unref (source);
+
+	if (!pixbuf) {
+		background_cache_unlock (lock);
+		return;
+	}
+
+	target->image = image_surface_from_pixbuf (pixbuf, target->scale);
+	g_object_unref (pixbuf);
+
+	/* Mapped entry replaces the private copy */
+	shared = background_cache_store (data->path, target->mode, target->filter,
+                                     target->width, target->height, target->scale,
+                                     target->image);
+	background_cache_unlock (lock);
+
+	if (shared) {
+		cairo_surface_destroy (target->image);
+		target->image = shared;
+	}
+
+	g_debug ("[Background] Prepared %s for %dx%d@%d in %.1f ms", data->path,
+             target->width, target->height, target->scale,
+             (g_get_monotonic_time () - start_time) / 1000.0);
+}
+
+static void
+background_load_target_run (gpointer item,
+                            gpointer user_data)
+{
+	BackgroundLoadTarget* target = item;
+	BackgroundLoadData* data = target->data;
+
+	background_load_target_prepare (target, user_data);
+
+	/* Decoded sources are not needed once all targets of the file are ready */
+	if (g_atomic_int_dec_and_test (&data->pending)) {
+		g_mutex_lock (&data->sources_lock);
+		g_hash_table_remove_all (data->sources);
+		g_mutex_unlock (&data->sources_lock);
+
+		g_mutex_lock (&data->preview_lock);
+		g_clear_object (&data->preview);
+		g_mutex_unlock (&data->preview_lock);
+	}
+}
+
+/* Prepares all monitor images in parallel and returns when all are ready */
+static void
+background_load_thread (GTask*        task,
+                        gpointer      source_object,
+                        gpointer      task_data,
+                        GCancellable* cancellable)
+{
+	GHashTable* loads = task_data;
+	GHashTableIter iter;
+	gpointer value;
+	GThreadPool* pool;
+	guint count = 0;
+	gint64 wall_time = g_get_monotonic_time ();
+	gint64 cpu_time = get_process_cpu_time ();
+
+	/* Slides are prefetched by one thread, to leave the CPU to the login UI */
+	pool = g_thread_pool_new (background_load_target_run, task,
+                              g_task_get_priority (task) > G_PRIORITY_DEFAULT ? 1 : g_get_num_processors (),
+                              FALSE, NULL);
+
+	g_hash_table_iter_init (&iter, loads);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		BackgroundLoadData* data = value;
+		GHashTableIter targets_iter;
+
+		data->pending = g_hash_table_size (data->targets);
+
+		g_hash_table_iter_init (&targets_iter, data->targets);
+		while (g_hash_table_iter_next (&targets_iter, NULL, &value)) {
+			g_thread_pool_push (pool, value, NULL);
+			count++;
+		}
+	}
+
+	g_thread_pool_free (pool, FALSE, TRUE);
+
+	if (g_task_return_error_if_cancelled (task))
+		return;
+
+	g_debug ("[Background] Prepared %u images: %.1f ms wall-clock, %.1f ms CPU time", count,
+             (g_get_monotonic_time () - wall_time) / 1000.0,
+             (get_process_cpu_time () - cpu_time) / 1000.0);
+
+	g_task_return_boolean (task, TRUE);
+}
+
+/* Sets the loaded image to the background, FALSE if it is not part of the load */
+static gboolean
+background_load_data_fill (BackgroundLoadData* data,
+                           Background*         bg,
+                           const GdkRGBA*      fallback)
+{
+	BackgroundLoadTarget* target;
+
+	if (!bg || !bg->key)
+		return FALSE;
+
+	target = g_hash_table_lookup (data->targets, bg->key);
+	if (!target)
+		return FALSE;
+
+	/* Background can be shared by several monitors */
+	if (bg->type == BACKGROUND_TYPE_IMAGE && !bg->options.image) {
+		if (target->image) {
+			bg->options.image = cairo_surface_reference (target->image);
+			g_clear_pointer (&bg->preview, cairo_surface_destroy);
+		} else {
+			g_warning ("[Background] Failed to read wallpaper: %s", data->path);
+			bg->type = BACKGROUND_TYPE_COLOR;
+			bg->options.color = *fallback;
+		}
+	}
+
+	return TRUE;
+}
+
+static void
+background_load_data_apply (GreeterBackground* background,
+                            BackgroundLoadData* data)
+{
+	gint i;
+	GreeterBackgroundPrivate* priv = background->priv;
+
+	for (i = 0; i < priv->monitors_size; ++i) {
+		Monitor* monitor = &priv->monitors[i];
+
+		/* Next slide is copied to the server now, so the crossfade starts without a stall */
+		if (background_load_data_fill (data, monitor->next_background, &priv->placeholder_color) &&
+		    monitor->next_background->options.image)
+			background_get_surface (monitor->next_background, gtk_widget_get_window (GTK_WIDGET (monitor->window)));
+
+		if (background_load_data_fill (data, monitor->background, &priv->placeholder_color))
+			monitor_update_background (monitor);
+	}
+
+	g_debug ("[Background] Background loaded after %.1f ms: %s",
+             (g_get_monotonic_time () - data->start_time) / 1000.0, data->path);
+}
+
+static gsize
+image_surface_get_size (cairo_surface_t* surface)
+{
+	if (!surface)
+		return 0;
+
+	return (gsize) cairo_image_surface_get_stride (surface) * cairo_image_surface_get_height (surface);
+}
+
+/* Debug report of the image memory held for each monitor */
+static void
+greeter_background_report_memory (GreeterBackground* background)
+{
+	gint i;
+	gsize heap = 0, mapped = 0, server = 0;
+	GHashTable* counted = g_hash_table_new (NULL, NULL);
+	GreeterBackgroundPrivate* priv = background->priv;
+
+	for (i = 0; i < priv->monitors_size; ++i) {
+		const Monitor* monitor = &priv->monitors[i];
+		Background* bg = monitor->background;
+		gsize image, preview;
+		gboolean image_mapped, shared;
+
+		if (!bg || bg->type != BACKGROUND_TYPE_IMAGE)
+			continue;
+
+		image = image_surface_get_size (bg->options.image);
+		preview = image_surface_get_size (bg->preview);
+		image_mapped = bg->options.image && background_cache_is_mapped (bg->options.image);
+		/* Background can be shared by several monitors */
+		shared = !g_hash_table_add (counted, bg);
+
+		g_debug ("[Background] Monitor %d (%s): image %" G_GSIZE_FORMAT " bytes (%s%s), preview %" G_GSIZE_FORMAT " bytes",
+                 monitor->number, monitor->name, image, image_mapped ? "mapped" : "heap",
+                 shared ? ", shared" : "", preview);
+
+		if (shared)
+			continue;
+
+		if (image_mapped)
+			mapped += image;
+		else
+			heap += image;
+		heap += preview;
+		/* Window-similar copy lives in a pixmap of the X server */
+		if (bg->surface)
+			server += image;
+	}
+
+	g_debug ("[Background] Images hold %" G_GSIZE_FORMAT " heap bytes, %" G_GSIZE_FORMAT " mapped cache bytes, "
+             "%" G_GSIZE_FORMAT " X server pixmap bytes", heap, mapped, server);
+
+	g_hash_table_unref (counted);
+}
+
+static void
+background_load_ready_cb (GObject*      object,
+                          GAsyncResult* result,
+                          gpointer      user_data)
+{
+	GError* error = NULL;
+	GHashTableIter iter;
+	gpointer value;
+	GHashTable* loads = g_task_get_task_data (G_TASK (result));
+
+	if (!g_task_propagate_boolean (G_TASK (result), &error)) {
+		/* Monitors are already destroyed */
+		g_clear_error (&error);
+		return;
+	}
+
+	/* All monitors are updated at once */
+	g_hash_table_iter_init (&iter, loads);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		background_load_data_apply (GREETER_BACKGROUND (object), value);
+
+	greeter_background_report_memory (GREETER_BACKGROUND (object));
+
+	greeter_background_slideshow_schedule (GREETER_BACKGROUND (object));
+}
+
+/* Path => <BackgroundLoadData*>, G_PRIORITY_LOW for prefetched slides */
+static void
+greeter_background_load_async (GreeterBackground* background,
+                               GHashTable*        loads,
+                               gint               priority)
+{
+	GTask* task;
+	GHashTableIter iter;
+	gpointer value;
+	guint images = 0;
+
+	/* Monitors with the same file, mode, size and scale share one target,
+	 * and all targets of a file share its decoded source */
+	g_hash_table_iter_init (&iter, loads);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		images += g_hash_table_size (((BackgroundLoadData*) value)->targets);
+	g_debug ("[Background] Loading %u files into %u images", g_hash_table_size (loads), images);
+
+	task = g_task_new (background, background->priv->load_cancellable,
+                       background_load_ready_cb, NULL);
+	g_task_set_priority (task, priority);
+	g_task_set_task_data (task, g_hash_table_ref (loads), (GDestroyNotify) g_hash_table_unref);
+	g_task_run_in_thread (task, background_load_thread);
+	g_object_unref (task);
+}
+
+static void
+greeter_background_disconnect (GreeterBackground* background)
+{
+	g_return_if_fail (GREETER_IS_BACKGROUND (background));
+	GreeterBackgroundPrivate* priv = background->priv;
+
+	if (priv->monitors_changed_handler_id)
+		g_signal_handler_disconnect (priv->screen, priv->monitors_changed_handler_id);
+	priv->monitors_changed_handler_id = 0;
+	layout_debounce_cancel (&priv->reconcile);
+	if (priv->slideshow_timer_id)
+		g_source_remove (priv->slideshow_timer_id);
+	priv->slideshow_timer_id = 0;
+	priv->slideshow_due = FALSE;
+	priv->screen = NULL;
+	priv->active_monitor = NULL;
+
+	if (priv->load_cancellable) {
+		g_cancellable_cancel (priv->load_cancellable);
+		g_clear_object (&priv->load_cancellable);
+	}
+
+	gint i;
+	for (i = 0; i < priv->monitors_size; ++i)
+		monitor_finalize (&priv->monitors[i]);
+
+	g_free (priv->monitors);
+	priv->monitors = NULL;
+	priv->monitors_size = 0;
+
+	g_hash_table_unref (priv->monitors_map);
+	priv->monitors_map = NULL;
+}
+
+/* The child lives in its own toplevel painted with the active monitor background.
+ * Switching monitors moves this window instead of reparenting (and so
+ * unrealizing) the whole child widget tree. */
+static void
+greeter_background_create_panel (GreeterBackground* background)
+{
+	GreeterBackgroundPrivate* priv = background->priv;
+	GSList* item;
+
+	priv->panel_window = GTK_WINDOW (gtk_window_new (GTK_WINDOW_TOPLEVEL));
+	gtk_window_set_decorated (priv->panel_window, FALSE);
+	gtk_window_set_resizable (priv->panel_window, FALSE);
+	gtk_widget_set_app_paintable (GTK_WIDGET (priv->panel_window), TRUE);
+	gtk_window_set_screen (priv->panel_window, priv->screen);
+
+	if (!priv->use_pixmap)
+		g_signal_connect (G_OBJECT (priv->panel_window), "draw",
+                          G_CALLBACK (panel_window_draw_cb), background);
+
+	/* Theme paints the child transparent, its backdrop is part of the panel background */
+	if (priv->panel_backdrop_blur >= 0) {
+		g_signal_connect (G_OBJECT (priv->panel_window), "size-allocate",
+                          G_CALLBACK (panel_window_size_allocate_cb), background);
+		if (priv->child)
+			gtk_style_context_add_class (gtk_widget_get_style_context (priv->child), "precomposited");
+	}
+
+	for (item = priv->accel_groups; item != NULL; item = g_slist_next(item))
+		gtk_window_add_accel_group (priv->panel_window, item->data);
+
+	if (priv->child)
+		gtk_container_add (GTK_CONTAINER (priv->panel_window), priv->child);
+}
+
+/* Places panel over the active monitor and raises it above monitor windows */
+static void
+greeter_background_update_panel (GreeterBackground* background)
+{
+	GreeterBackgroundPrivate* priv = background->priv;
+
+	if (!priv->panel_window || !priv->active_monitor)
+		return;
+
+	window_apply_geometry (priv->panel_window, &priv->active_monitor->geometry);
+
+	if (priv->use_pixmap)
+		gtk_widget_realize (GTK_WIDGET (priv->panel_window));
+	greeter_background_update_panel_background (background);
+
+	gtk_widget_show (GTK_WIDGET (priv->panel_window));
+	gtk_window_present (priv->panel_window);
+}
+
+static void
+greeter_background_set_active_monitor (GreeterBackground* background, const Monitor* active)
+{
+	GreeterBackgroundPrivate* priv = background->priv;
+
+	if (active && !active->background) {
+		if (priv->active_monitor)
+			return;
+
+		active = NULL;
+	}
+
+    /* Auto */
+	if (!active) {
+		/* Using primary monitor */
+		if (!active) {
+			gint i;
+			GdkDisplay *display;
+
+			display = gdk_display_get_default ();
+
+			for (i = 0; i < priv->monitors_size; i++) {
+				GdkMonitor *gdk_monitor = gdk_display_get_monitor (display, i);
+				if (gdk_monitor_is_primary (gdk_monitor)) {
+					active = &priv->monitors[i];
+					break;
+				}
+			}
+
+			if (!active->background)
+				active = NULL;
+			if (active)
+				g_debug ("[Background] Active monitor is not specified, using primary monitor");
+		}
+
+		/* Fallback: first enabled and/or not skipped monitor (screen always have one) */
+		if (!active) {
+			gint i;
+			for (i = 0; i < priv->monitors_size; i++) {
+				const Monitor* monitor = &priv->monitors[i];
+				if (monitor->background) {
+					active = monitor;
+					break;
+				}
+			}
+			if (active)
+				g_debug ("[Background] Active monitor is not specified, using first enabled monitor");
+		}
+	}
+
+	if (!active) {
+		if (priv->active_monitor)
+			g_warning ("[Background] Active monitor is not specified, failed to identify. Active monitor stays the same: %s #%d", priv->active_monitor->name, priv->active_monitor->number);
+		else
+			g_warning ("[Background] Active monitor is not specified, failed to identify. Active monitor stays the same: <not defined>");
+		return;
+	}
+
+	if (active == priv->active_monitor)
+		return;
+
+	priv->active_monitor = active;
+
+	g_return_if_fail (priv->active_monitor != NULL);
+
+	if (!priv->child)
+		g_warning ("[Background] Child widget is destroyed or not defined");
+
+	/* Child stays realized in the panel window, only the panel is moved */
+	greeter_background_update_panel (background);
+
 	g_debug ("[Background] Active monitor changed to: %s #%d", active->name, active->number);
 	g_signal_emit (background, background_signals[BACKGROUND_SIGNAL_ACTIVE_MONITOR_CHANGED], 0);
 
-	gint x, y;
-	greeter_background_get_cursor_position (background, &x, &y);
-	/* Do not center cursor if it is already inside active monitor */
-	if (x < active->geometry.x || x >= active->geometry.x + active->geometry.width ||
-        y < active->geometry.y || y >= active->geometry.y + active->geometry.height) {
-		greeter_background_set_cursor_position( background,
-                                                active->geometry.x + active->geometry.width/2,
-                                                active->geometry.y + active->geometry.height/2);
+	gint x, y;
+	greeter_background_get_cursor_position (background, &x, &y);
+	/* Do not center cursor if it is already inside active monitor */
+	if (x < active->geometry.x || x >= active->geometry.x + active->geometry.width ||
+        y < active->geometry.y || y >= active->geometry.y + active->geometry.height) {
+		greeter_background_set_cursor_position( background,
+                                                active->geometry.x + active->geometry.width/2,
+                                                active->geometry.y + active->geometry.height/2);
+	}
+}
+
+static void
+greeter_background_finalize (GObject *object)
+{
+	GreeterBackground *background = GREETER_BACKGROUND (object);
+
+	greeter_background_disconnect (background);
+
+	if (background->priv->panel_window) {
+		/* remove greeter widget to avoid "destroy" signal */
+		if (background->priv->child)
+			gtk_container_remove (GTK_CONTAINER (background->priv->panel_window), background->priv->child);
+		gtk_widget_destroy (GTK_WIDGET (background->priv->panel_window));
+		background->priv->panel_window = NULL;
+	}
+
+	g_clear_object (&background->priv->child);
+	g_clear_pointer (&background->priv->panel_backdrop, cairo_surface_destroy);
+	g_clear_pointer (&background->priv->default_monitor_config, monitor_config_free);
+	g_clear_pointer (&background->priv->configs, g_hash_table_unref);
+
+	G_OBJECT_CLASS (greeter_background_parent_class)->finalize (object);
+}
+
+static void
+greeter_background_init (GreeterBackground* self)
+{
+	GreeterBackgroundPrivate* priv;
+	priv = self->priv = greeter_background_get_instance_private (self);
+
+	priv->screen = NULL;
+	priv->monitors_changed_handler_id = 0;
+	priv->accel_groups = NULL;
+
+	priv->default_monitor_config = monitor_config_copy (&DEFAULT_MONITOR_CONFIG, NULL);
+	priv->configs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                           (GDestroyNotify) monitor_config_free);
+
+	priv->monitors = NULL;
+	priv->monitors_size = 0;
+	priv->monitors_map = NULL;
+
+	priv->active_monitor = NULL;
+
+	priv->use_pixmap = FALSE;
+	priv->placeholder_color = DEFAULT_MONITOR_CONFIG.bg.options.color;
+	greeter_background_set_scaling_filter (self, NULL);
+	priv->load_cancellable = NULL;
+	priv->panel_window = NULL;
+	layout_debounce_init (&priv->reconcile, MONITORS_CHANGED_DELAY, greeter_background_reconcile_cb, self);
+	priv->panel_backdrop_blur = -1;
+	priv->panel_backdrop = NULL;
+	priv->slideshow_interval = 0;
+	priv->slideshow_index = 0;
+	priv->slideshow_timer_id = 0;
+	priv->slideshow_due = FALSE;
+}
+
+static void
+greeter_background_class_init (GreeterBackgroundClass* klass)
+{
+	GObjectClass* gobject_class = G_OBJECT_CLASS(klass);
+
+	gobject_class->finalize = greeter_background_finalize;
+
+	background_signals[BACKGROUND_SIGNAL_ACTIVE_MONITOR_CHANGED] =
+					g_signal_new ("active-monitor-changed",
+                                  G_TYPE_FROM_CLASS(gobject_class),
+                                  G_SIGNAL_RUN_FIRST,
+                                  0, /* class_offset */
+                                  NULL /* accumulator */, NULL /* accu_data */,
+                                  g_cclosure_marshal_VOID__VOID,
+                                  G_TYPE_NONE, 0);
+}
+
+GreeterBackground*
+greeter_background_new (GtkWidget* child)
+{
+	GreeterBackground* background;
+	g_return_val_if_fail (child != NULL, NULL);
+
+	background = GREETER_BACKGROUND (g_object_new (greeter_background_get_type(), NULL));
+
+	background->priv->child = g_object_ref (child);
+
+//	g_signal_connect (background->priv->child, "destroy",
+//                      G_CALLBACK (greeter_background_child_destroyed_cb), background);
+
+	return background;
+}
+
+/* Config of the monitor with this model name or number, NULL name for unlisted monitors.
+ * Listed monitors without a valid background use the default one. */
+void
+greeter_background_set_monitor_config (GreeterBackground* background,
+                                       const gchar*       name,
+                                       const gchar*       bg)
+{
+	g_return_if_fail (GREETER_IS_BACKGROUND (background));
+
+	GreeterBackgroundPrivate* priv = background->priv;
+
+	MonitorConfig* config = g_new0 (MonitorConfig, 1);
+
+	if (!background_config_initialize (&config->bg, bg)) {
+		if (name) {
+			g_hash_table_remove (priv->configs, name);
+			g_free (config);
+			return;
+		}
+		background_config_copy (&DEFAULT_MONITOR_CONFIG.bg, &config->bg);
+	}
+
+	if (name) {
+		g_hash_table_replace (priv->configs, g_strdup (name), config);
+		return;
+	}
+
+	if (priv->default_monitor_config)
+		monitor_config_free (priv->default_monitor_config);
+	priv->default_monitor_config = config;
+}
+
+void
+greeter_background_set_use_pixmap (GreeterBackground* background, gboolean use_pixmap)
+{
+	g_return_if_fail (GREETER_IS_BACKGROUND (background));
+
+	background->priv->use_pixmap = use_pixmap;
+}
+
+/* Accepts filter name for all modes or "mode:filter" list, e.g. "zoomed:area;stretched:bilinear" */
+void
+greeter_background_set_scaling_filter (GreeterBackground* background, const gchar* value)
+{
+	g_return_if_fail (GREETER_IS_BACKGROUND (background));
+
+	image_parse_scaling_filters (value, background->priv->scaling_filters);
+}
+
+/* "dim" composites the child backdrop into the panel background, "blur" also blurs it */
+void
+greeter_background_set_panel_backdrop (GreeterBackground* background, const gchar* value)
+{
+	g_return_if_fail (GREETER_IS_BACKGROUND (background));
+
+	GreeterBackgroundPrivate* priv = background->priv;
+
+	priv->panel_backdrop_blur = -1;
+
+	if (!value || g_strcmp0 (value, "false") == 0)
+		return;
+
+	if (g_strcmp0 (value, "dim") == 0)
+		priv->panel_backdrop_blur = 0;
+	else if (g_strcmp0 (value, "blur") == 0)
+		priv->panel_backdrop_blur = PANEL_BACKDROP_BLUR_RADIUS;
+	else
+		g_warning ("[Background] Unknown panel backdrop: %s", value);
+}
+
+/* Seconds each slide of a slideshow background is shown, 0 shows the first one only */
+void
+greeter_background_set_slideshow_interval (GreeterBackground* background, gint interval)
+{
+	g_return_if_fail (GREETER_IS_BACKGROUND (background));
+
+	background->priv->slideshow_interval = MAX (0, interval);
+}
+
+void
+greeter_background_set_placeholder_color (GreeterBackground* background, const gchar* color)
+{
+	g_return_if_fail (GREETER_IS_BACKGROUND (background));
+
+	if (!color || !gdk_rgba_parse (&background->priv->placeholder_color, color))
+		background->priv->placeholder_color = DEFAULT_MONITOR_CONFIG.bg.options.color;
+}
+
+static void
+monitor_create_window (Monitor* monitor, GdkScreen* screen)
+{
+	GreeterBackgroundPrivate* priv = monitor->object->priv;
+	GSList* item;
+
+	monitor->window = GTK_WINDOW (gtk_window_new (GTK_WINDOW_TOPLEVEL));
+	gtk_window_set_type_hint (monitor->window, GDK_WINDOW_TYPE_HINT_DESKTOP);
+	gtk_window_set_keep_below (monitor->window, TRUE);
+	gtk_window_set_resizable (monitor->window, FALSE);
+	gtk_widget_set_app_paintable (GTK_WIDGET (monitor->window), TRUE);
+	gtk_window_set_screen (monitor->window, screen);
+	window_apply_geometry (monitor->window, &monitor->geometry);
+
+	if (!priv->use_pixmap)
+		monitor->window_draw_handler_id = g_signal_connect (G_OBJECT (monitor->window), "draw",
+                                                            G_CALLBACK (monitor_window_draw_cb),
+                                                            monitor);
+
+	for (item = priv->accel_groups; item != NULL; item = g_slist_next(item))
+		gtk_window_add_accel_group (monitor->window, item->data);
+
+//        g_signal_connect(G_OBJECT(monitor->window), "enter-notify-event",
+//                         G_CALLBACK(monitor_window_enter_notify_cb), monitor);
+}
+
+/* Moves monitor to its slot in the new monitors array */
+static void
+monitor_move (Monitor* dest, Monitor* src)
+{
+	*dest = *src;
+	*src = INVALID_MONITOR_STRUCT;
+
+	/* "draw" handler and tick callback data is the old address */
+	if (dest->window_draw_handler_id) {
+		g_signal_handler_disconnect (dest->window, dest->window_draw_handler_id);
+		dest->window_draw_handler_id = g_signal_connect (G_OBJECT (dest->window), "draw",
+                                                         G_CALLBACK (monitor_window_draw_cb),
+                                                         dest);
+	}
+	if (dest->transition_tick_id) {
+		gtk_widget_remove_tick_callback (GTK_WIDGET (dest->window), dest->transition_tick_id);
+		dest->transition_tick_id = gtk_widget_add_tick_callback (GTK_WIDGET (dest->window),
+                                                                 monitor_transition_tick_cb,
+                                                                 dest, NULL);
+	}
+}
+
+static const MonitorConfig*
+monitor_get_config (const Monitor* monitor)
+{
+	GreeterBackgroundPrivate* priv = monitor->object->priv;
+	const MonitorConfig* config = NULL;
+	gchar* number;
+
+	if (monitor->name)
+		config = g_hash_table_lookup (priv->configs, monitor->name);
+
+	if (!config) {
+		number = g_strdup_printf ("%d", monitor->number);
+		config = g_hash_table_lookup (priv->configs, number);
+		g_free (number);
+	}
+
+	return config ? config : priv->default_monitor_config;
+}
+
+/* Creates background for the monitor, sharing it with other monitors or queuing it for loading.
+ * images: Key => <Background*>, loads: Path => <BackgroundLoadData*> */
+static Background*
+monitor_create_background (Monitor*                monitor,
+                           const BackgroundConfig* config,
+                           GHashTable*             images,
+                           GHashTable*             loads)
+{
+	GreeterBackgroundPrivate* priv = monitor->object->priv;
+	Background* bg;
+
+	bg = background_new (config, monitor);
+	if (!bg)
+		bg = background_new (&DEFAULT_MONITOR_CONFIG.bg, monitor);
+
+	if (bg->type == BACKGROUND_TYPE_IMAGE) {
+		Background* shared = g_hash_table_lookup (images, bg->key);
+
+		if (shared) {
+			background_unref (&bg);
+			bg = background_ref (shared);
+		} else {
+			const gchar* path = config->options.image.path;
+			BackgroundLoadData* data = g_hash_table_lookup (loads, path);
+			BackgroundLoadTarget* target = g_new0 (BackgroundLoadTarget, 1);
+
+			if (!data) {
+				data = background_load_data_new (path);
+				g_hash_table_insert (loads, data->path, data);
+			}
+
+			target->data = data;
+			target->key = g_strdup (bg->key);
+			target->mode = config->options.image.mode;
+			target->filter = priv->scaling_filters[target->mode];
+			target->width = bg->area.width * monitor->scale;
+			target->height = bg->area.height * monitor->scale;
+			target->scale = monitor->scale;
+			g_hash_table_insert (data->targets, (gpointer) target->key, target);
+
+			g_hash_table_insert (images, bg->key, background_ref (bg));
+		}
+	}
+
+	return bg;
+}
+
+/* Attaches the current slide of the monitor config */
+static void
+monitor_attach_background (Monitor*    monitor,
+                           GHashTable* images,
+                           GHashTable* loads)
+{
+	BackgroundConfig slide;
+
+	monitor->config = monitor_get_config (monitor);
+	background_config_get_slide (&monitor->config->bg, monitor->object->priv->slideshow_index, &slide);
+	monitor->background = monitor_create_background (monitor, &slide, images, loads);
+}
+
+static void
+background_unref_notify (gpointer bg)
+{
+	background_unref ((Background**) &bg);
+}
+
+static gboolean
+greeter_background_is_transitioning (GreeterBackground* background)
+{
+	GreeterBackgroundPrivate* priv = background->priv;
+	gint i;
+
+	for (i = 0; i < priv->monitors_size; ++i)
+		if (priv->monitors[i].previous_background)
+			return TRUE;
+
+	return FALSE;
+}
+
+/* Loads the slide after the current one for all monitors, it waits there
+ * until the interval is over. With the current slide that is two images per monitor. */
+static void
+greeter_background_slideshow_prefetch (GreeterBackground* background)
+{
+	GreeterBackgroundPrivate* priv = background->priv;
+	GHashTable* images;
+	GHashTable* loads;
+	gint i;
+
+	images = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, background_unref_notify);
+	loads = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                   (GDestroyNotify) background_load_data_free);
+
+	for (i = 0; i < priv->monitors_size; ++i) {
+		Monitor* monitor = &priv->monitors[i];
+		BackgroundConfig slide;
+
+		/* Skipped monitor */
+		if (!monitor->window || !monitor->background)
+			continue;
+
+		if (monitor->next_background) {
+			if (monitor->next_background->key && !g_hash_table_contains (images, monitor->next_background->key))
+				g_hash_table_insert (images, monitor->next_background->key,
+                                     background_ref (monitor->next_background));
+			continue;
+		}
+
+		if (!background_config_get_slide (&monitor->config->bg, priv->slideshow_index + 1, &slide))
+			continue;
+
+		monitor->next_background = monitor_create_background (monitor, &slide, images, loads);
 	}
+
+	if (g_hash_table_size (loads) > 0)
+		greeter_background_load_async (background, loads, G_PRIORITY_LOW);
+
+	g_hash_table_unref (loads);
+	g_hash_table_unref (images);
 }
 
-static void
-greeter_background_finalize (GObject *object)
+static gboolean
+greeter_background_has_slideshow (GreeterBackground* background)
 {
-	GreeterBackground *background = GREETER_BACKGROUND (object);
+	GreeterBackgroundPrivate* priv = background->priv;
+	BackgroundConfig slide;
+	gint i;
 
-	greeter_background_disconnect (background);
+	for (i = 0; i < priv->monitors_size; ++i) {
+		const Monitor* monitor = &priv->monitors[i];
 
-	g_clear_object (&background->priv->child);
+		if (monitor->background && background_config_get_slide (&monitor->config->bg, 0, &slide))
+			return TRUE;
+	}
 
-	G_OBJECT_CLASS (greeter_background_parent_class)->finalize (object);
+	return FALSE;
 }
 
-static void
-greeter_background_init (GreeterBackground* self)
+static gboolean
+greeter_background_slideshow_ready (GreeterBackground* background)
 {
-	GreeterBackgroundPrivate* priv;
-	priv = self->priv = greeter_background_get_instance_private (self);
-
-	priv->screen = NULL;
-	priv->monitors_changed_handler_id = 0;
-	priv->accel_groups = NULL;
+	GreeterBackgroundPrivate* priv = background->priv;
+	gint i;
 
-	priv->default_monitor_config = monitor_config_copy (&DEFAULT_MONITOR_CONFIG, NULL);
+	for (i = 0; i < priv->monitors_size; ++i) {
+		Background* bg = priv->monitors[i].next_background;
 
-	priv->monitors = NULL;
-	priv->monitors_size = 0;
-	priv->monitors_map = NULL;
+		if (bg && bg->type == BACKGROUND_TYPE_IMAGE && !bg->options.image)
+			return FALSE;
+	}
 
-	priv->active_monitor = NULL;
+	return TRUE;
 }
 
 static void
-greeter_background_class_init (GreeterBackgroundClass* klass)
+greeter_background_slideshow_advance (GreeterBackground* background)
 {
-	GObjectClass* gobject_class = G_OBJECT_CLASS(klass);
+	GreeterBackgroundPrivate* priv = background->priv;
+	gint i;
 
-	gobject_class->finalize = greeter_background_finalize;
+	priv->slideshow_due = FALSE;
+	priv->slideshow_index++;
 
-	background_signals[BACKGROUND_SIGNAL_ACTIVE_MONITOR_CHANGED] =
-					g_signal_new ("active-monitor-changed",
-                                  G_TYPE_FROM_CLASS(gobject_class),
-                                  G_SIGNAL_RUN_FIRST,
-                                  0, /* class_offset */
-                                  NULL /* accumulator */, NULL /* accu_data */,
-                                  g_cclosure_marshal_VOID__VOID,
-                                  G_TYPE_NONE, 0);
-}
+	for (i = 0; i < priv->monitors_size; ++i) {
+		Monitor* monitor = &priv->monitors[i];
+		Background* next = monitor->next_background;
 
-GreeterBackground*
-greeter_background_new (GtkWidget* child)
-{
-	GreeterBackground* background;
-	g_return_val_if_fail (child != NULL, NULL);
+		if (!next)
+			continue;
 
-	background = GREETER_BACKGROUND (g_object_new (greeter_background_get_type(), NULL));
+		monitor->next_background = NULL;
+		monitor_start_transition (monitor, next);
+	}
 
-	background->priv->child = g_object_ref (child);
+	g_debug ("[Background] Slide %u shown", priv->slideshow_index);
+}
 
-//	g_signal_connect (background->priv->child, "destroy",
-//                      G_CALLBACK (greeter_background_child_destroyed_cb), background);
+static gboolean
+greeter_background_slideshow_timeout_cb (GreeterBackground* background)
+{
+	background->priv->slideshow_timer_id = 0;
+	background->priv->slideshow_due = TRUE;
 
-	return background;
+	greeter_background_slideshow_schedule (background);
+
+	return G_SOURCE_REMOVE;
 }
 
-void
-greeter_background_set_monitor_config (GreeterBackground* background, const gchar* bg)
+/* Slide is switched when the interval is over and the next one is loaded,
+ * the interval of the next slide starts when the crossfade is over */
+static void
+greeter_background_slideshow_schedule (GreeterBackground* background)
 {
-	g_return_if_fail (GREETER_IS_BACKGROUND (background));
-
 	GreeterBackgroundPrivate* priv = background->priv;
 
-	MonitorConfig* config = g_new0 (MonitorConfig, 1);
+	if (!priv->slideshow_interval || !priv->screen || !greeter_background_has_slideshow (background))
+		return;
 
-	if (!background_config_initialize (&config->bg, bg))
-		background_config_copy (&DEFAULT_MONITOR_CONFIG.bg, &config->bg);
+	if (greeter_background_is_transitioning (background))
+		return;
 
-	if (priv->default_monitor_config)
-		monitor_config_free (priv->default_monitor_config);
-	priv->default_monitor_config = config;
-}
+	if (priv->slideshow_due) {
+		if (!greeter_background_slideshow_ready (background))
+			return;
 
-void
-greeter_background_connect (GreeterBackground* background, GdkScreen* screen)
-{
-	g_return_if_fail (GREETER_IS_BACKGROUND (background));
-	g_return_if_fail (GDK_IS_SCREEN (screen));
+		greeter_background_slideshow_advance (background);
+		if (greeter_background_is_transitioning (background))
+			return;
+	}
 
-	g_debug ("[Background] Connecting to screen: %p", screen);
+	if (!priv->slideshow_timer_id)
+		priv->slideshow_timer_id = g_timeout_add_seconds (priv->slideshow_interval,
+                                                          (GSourceFunc) greeter_background_slideshow_timeout_cb,
+                                                          background);
 
-	GreeterBackgroundPrivate* priv = background->priv;
-	gpointer saved_focus = NULL;
-	if (priv->screen) {
-		if (priv->active_monitor)
-			saved_focus = greeter_save_focus (priv->child);
-		greeter_background_disconnect (background);
-	}
+	greeter_background_slideshow_prefetch (background);
+}
 
+/* Brings monitor windows in line with the screen layout. Monitors that did not
+ * change are kept as is, others are created, destroyed, moved or rescaled. */
+static void
+greeter_background_reconcile (GreeterBackground* background)
+{
+	GreeterBackgroundPrivate* priv = background->priv;
 	GdkDisplay *display = gdk_display_get_default ();
+	Monitor* old_monitors = priv->monitors;
+	gsize old_monitors_size = priv->monitors_size;
+	const Monitor* old_active = priv->active_monitor;
+	const Monitor* active;
+	gboolean active_changed = FALSE;
+	LayoutMonitor* old_layout;
+	LayoutMonitor* layout;
+	LayoutDiff* diff;
+	gint i;
 
-	priv->screen = screen;
 	priv->monitors_size = gdk_display_get_n_monitors (display);
 	priv->monitors = g_new0 (Monitor, priv->monitors_size);
-	priv->monitors_map = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	priv->active_monitor = NULL;
+	g_hash_table_remove_all (priv->monitors_map);
+
+	/* Old monitors without a window were skipped */
+	old_layout = g_new0 (LayoutMonitor, old_monitors_size);
+	for (i = 0; i < old_monitors_size; ++i) {
+		old_layout[i].name = old_monitors[i].name;
+		old_layout[i].geometry = old_monitors[i].geometry;
+		old_layout[i].scale = old_monitors[i].scale;
+		old_layout[i].skipped = !old_monitors[i].window;
+	}
 
-	g_debug("[Background] Monitors found: %" G_GSIZE_FORMAT, priv->monitors_size);
+	layout = g_new0 (LayoutMonitor, priv->monitors_size);
+	for (i = 0; i < priv->monitors_size; ++i) {
+		GdkMonitor *gdk_monitor = gdk_display_get_monitor (display, i);
 
-	GHashTable* images_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
-	cairo_region_t *screen_region = cairo_region_create ();
-	gint i;
+		layout[i].name = gdk_monitor_get_model (gdk_monitor);
+		gdk_monitor_get_geometry (gdk_monitor, &layout[i].geometry);
+		layout[i].scale = MAX (1, gdk_monitor_get_scale_factor (gdk_monitor));
 
-	for (i = 0; i < priv->monitors_size; ++i) {
-		GdkMonitor *gdk_monitor;
-		const MonitorConfig* monitor_config;
-		const gchar* printable_name;
-		Monitor* monitor = &priv->monitors[i];
-		gdk_monitor = gdk_display_get_monitor (display, i);
+		/* Spanned images cover all monitors */
+		if (i == 0)
+			priv->screen_geometry = layout[i].geometry;
+		else
+			gdk_rectangle_union (&priv->screen_geometry, &layout[i].geometry, &priv->screen_geometry);
+	}
+
+	layout_mark_skipped (layout, priv->monitors_size);
+	diff = layout_diff (old_layout, old_monitors_size, layout, priv->monitors_size);
+	g_free (old_layout);
 
-		monitor->object = background;
-		monitor->name = g_strdup (gdk_monitor_get_model (gdk_monitor));
-		monitor->number = i;
+	g_debug("[Background] Monitors found: %" G_GSIZE_FORMAT, priv->monitors_size);
 
-		printable_name = monitor->name ? monitor->name : "<unknown>";
+	/* Key => <Background*>, images shared by monitors, existing ones included */
+	GHashTable* images = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, background_unref_notify);
+	/* Path => <BackgroundLoadData*> */
+	GHashTable* loads = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                               (GDestroyNotify) background_load_data_free);
 
-		gdk_monitor_get_geometry (gdk_monitor, &monitor->geometry);
+	for (i = 0; i < old_monitors_size; ++i) {
+		Background* bg = old_monitors[i].background;
+		if (bg && bg->key && !g_hash_table_contains (images, bg->key))
+			g_hash_table_insert (images, bg->key, background_ref (bg));
+	}
 
-		g_debug ("[Background] Monitor: %s #%d (%dx%d at %dx%d)%s", printable_name, i,
-                 monitor->geometry.width, monitor->geometry.height,
-                 monitor->geometry.x, monitor->geometry.y,
-                 (i == gdk_monitor_is_primary (gdk_monitor)) ? " primary" : "");
+	for (i = 0; i < priv->monitors_size; ++i) {
+		const gchar* name = layout[i].name;
+		const gchar* printable_name = name ? name : "<unknown>";
+		GdkRectangle geometry = layout[i].geometry;
+		gint scale = layout[i].scale;
+		Monitor* monitor = &priv->monitors[i];
 
-		monitor_config = priv->default_monitor_config;
+		g_debug ("[Background] Monitor: %s #%d (%dx%d at %dx%d, scale %d)%s", printable_name, i,
+                 geometry.width, geometry.height, geometry.x, geometry.y, scale,
+                 gdk_monitor_is_primary (gdk_display_get_monitor (display, i)) ? " primary" : "");
 
-		/* Simple check to skip fully overlapped monitors.
-		   Actually, it's can track only monitors in "mirrors" mode. Nothing more. */
-		if (cairo_region_contains_rectangle (screen_region, &monitor->geometry) == CAIRO_REGION_OVERLAP_IN) {
+		if (diff->changes[i] == LAYOUT_CHANGE_SKIPPED) {
 			g_debug ("[Background] Skipping monitor %s #%d, its area is already used by other monitors", printable_name, i);
+			monitor->object = background;
+			monitor->name = g_strdup (name);
+			monitor->number = i;
+			monitor->geometry = geometry;
+			monitor->scale = scale;
 			continue;
 		}
-		cairo_region_union_rectangle (screen_region, &monitor->geometry);
-
-		monitor->window = GTK_WINDOW (gtk_window_new (GTK_WINDOW_TOPLEVEL));
-		gtk_window_set_type_hint (monitor->window, GDK_WINDOW_TYPE_HINT_DESKTOP);
-		gtk_window_set_keep_below (monitor->window, TRUE);
-		gtk_window_set_resizable (monitor->window, FALSE);
-		gtk_widget_set_app_paintable (GTK_WIDGET (monitor->window), TRUE);
-		gtk_window_set_screen (monitor->window, screen);
-		gtk_widget_set_size_request (GTK_WIDGET (monitor->window),
-                                     monitor->geometry.width, monitor->geometry.height);
-		gtk_window_move (monitor->window, monitor->geometry.x, monitor->geometry.y);
 
-		monitor->window_draw_handler_id = g_signal_connect (G_OBJECT (monitor->window), "draw",
-                                                            G_CALLBACK (monitor_window_draw_cb),
-                                                            monitor);
+		if (diff->sources[i] >= 0) {
+			Monitor* old = &old_monitors[diff->sources[i]];
 
-		GSList* item = NULL;
-		for (item = priv->accel_groups; item != NULL; item = g_slist_next(item))
-			gtk_window_add_accel_group (monitor->window, item->data);
+			if (old == old_active)
+				priv->active_monitor = monitor;
 
-//        g_signal_connect(G_OBJECT(monitor->window), "enter-notify-event",
-//                         G_CALLBACK(monitor_window_enter_notify_cb), monitor);
+			monitor_move (monitor, old);
+			monitor->number = i;
 
-		monitor->background = background_new (&monitor_config->bg, monitor, images_cache);
-		if (!monitor->background)
-			monitor->background = background_new (&DEFAULT_MONITOR_CONFIG.bg, monitor, images_cache);
+			if (diff->changes[i] == LAYOUT_CHANGE_MOVED) {
+				g_debug ("[Background] Monitor %s #%d moved", printable_name, i);
+
+				if (monitor->geometry.width != geometry.width ||
+				    monitor->geometry.height != geometry.height ||
+				    monitor->scale != scale)
+					monitor_clear_background (monitor);
+
+				monitor->geometry = geometry;
+				monitor->scale = scale;
+				window_apply_geometry (monitor->window, &monitor->geometry);
+
+				if (monitor == priv->active_monitor)
+					active_changed = TRUE;
+			}
+
+			/* Spanned image depends on the other monitors too */
+			if (monitor->background && monitor->background->spanned &&
+			    !gdk_rectangle_equal (&monitor->background->area, &priv->screen_geometry))
+				monitor_clear_background (monitor);
+
+			/* Config is looked up by name or number, the number may have changed */
+			if (monitor->background && monitor->config != monitor_get_config (monitor))
+				monitor_clear_background (monitor);
+
+			if (!monitor->background)
+				monitor_attach_background (monitor, images, loads);
+
+			monitor_update_background (monitor);
+		} else {
+			monitor->object = background;
+			monitor->name = g_strdup (name);
+			monitor->number = i;
+			monitor->geometry = geometry;
+			monitor->scale = scale;
+
+			monitor_create_window (monitor, priv->screen);
+			monitor_attach_background (monitor, images, loads);
+
+			if (priv->use_pixmap) {
+				gtk_widget_realize (GTK_WIDGET (monitor->window));
+				monitor_set_window_background (monitor);
+			}
+
+			gtk_widget_show_all (GTK_WIDGET (monitor->window));
+		}
 
 		if (monitor->name)
 			g_hash_table_insert (priv->monitors_map, g_strdup (monitor->name), monitor);
 		g_hash_table_insert (priv->monitors_map, g_strdup_printf ("%d", i), monitor);
-
-		gtk_widget_show_all (GTK_WIDGET (monitor->window));
 	}
-	g_hash_table_unref (images_cache);
 
-	if (!priv->active_monitor)
-		greeter_background_set_active_monitor (background, NULL);
+	/* Monitors left in the old array are gone */
+	for (i = 0; i < old_monitors_size; ++i)
+		monitor_finalize (&old_monitors[i]);
+	g_free (old_monitors);
+
+	/* Monitors show placeholder color until images are ready, the slideshow
+	 * goes on when they are */
+	if (g_hash_table_size (loads) > 0)
+		greeter_background_load_async (background, loads, G_PRIORITY_DEFAULT);
+	else
+		greeter_background_slideshow_schedule (background);
+
+	g_hash_table_unref (loads);
+	g_hash_table_unref (images);
+
+	g_debug ("[Background] Monitors reconciled: %d kept, %d moved, %d created, %d removed",
+             diff->kept, diff->moved, diff->created, diff->removed_count);
 
-	if (saved_focus) {
-		greeter_restore_focus (saved_focus);
-		g_free (saved_focus);
+	active = priv->active_monitor;
+	if (!active) {
+		greeter_background_set_active_monitor (background, NULL);
+	} else if (active_changed || diff->created || diff->removed_count) {
+		/* Same active monitor, but it has moved or new windows are stacked above the panel */
+		greeter_background_update_panel (background);
+		/* Listeners depend on the layout too */
+		g_signal_emit (background, background_signals[BACKGROUND_SIGNAL_ACTIVE_MONITOR_CHANGED], 0);
 	}
 
+	layout_diff_free (diff);
+	g_free (layout);
+}
+
+static void
+greeter_background_reconcile_cb (guint events, gpointer user_data)
+{
+	g_debug ("[Background] Reconciling monitors after %u change events", events);
+
+	greeter_background_reconcile (GREETER_BACKGROUND (user_data));
+}
+
+/* RandR changes come in bursts (docking stations), handle only the last one */
+static void
+greeter_background_monitors_changed_cb (GdkScreen* screen, GreeterBackground* background)
+{
+	g_return_if_fail (GREETER_IS_BACKGROUND (background));
+
+	layout_debounce_event (&background->priv->reconcile);
+}
+
+void
+greeter_background_connect (GreeterBackground* background, GdkScreen* screen)
+{
+	g_return_if_fail (GREETER_IS_BACKGROUND (background));
+	g_return_if_fail (GDK_IS_SCREEN (screen));
+
+	g_debug ("[Background] Connecting to screen: %p", screen);
+
+	GreeterBackgroundPrivate* priv = background->priv;
+	if (priv->screen)
+		greeter_background_disconnect (background);
+
+	priv->screen = screen;
+	priv->monitors_map = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	priv->load_cancellable = g_cancellable_new ();
+
+	if (!priv->panel_window)
+		greeter_background_create_panel (background);
+	else
+		gtk_window_set_screen (priv->panel_window, screen);
+
+	/* Nothing to keep, all monitors are created */
+	greeter_background_reconcile (background);
+
 	priv->monitors_changed_handler_id = g_signal_connect (G_OBJECT (screen), "monitors-changed",
 			G_CALLBACK (greeter_background_monitors_changed_cb), background);
 }
 
+/* Returns new pixbuf with the active monitor image, if any */
 GdkPixbuf *
 greeter_background_pixbuf_get (GreeterBackground* background)
 {
@@ -835,10 +2353,12 @@ greeter_background_pixbuf_get (GreeterBackground* background)
 
 	bg = priv->active_monitor->background;
 
-	if (!bg)
+	if (!bg || bg->type != BACKGROUND_TYPE_IMAGE || !bg->options.image)
 		return NULL;
 
-	return bg->options.image;
+	return gdk_pixbuf_get_from_surface (bg->options.image, 0, 0,
+                                        cairo_image_surface_get_width (bg->options.image),
+                                        cairo_image_surface_get_height (bg->options.image));
 }
 
 const GdkRectangle *
@@ -865,6 +2385,9 @@ greeter_background_add_accel_group (GreeterBackground* background,
 				gtk_window_add_accel_group (priv->monitors[i].window, group);
 	}
 
+	if (priv->panel_window)
+		gtk_window_add_accel_group (priv->panel_window, group);
+
 	priv->accel_groups = g_slist_append(priv->accel_groups, group);
 }
 
@@ -921,98 +2444,102 @@ greeter_background_set_active_monitor_from_geometry (GreeterBackground  *backgro
 /* The following code for setting a RetainPermanent background pixmap was taken
    originally from Gnome, with some fixes from MATE. see:
    https://github.com/mate-desktop/mate-desktop/blob/master/libmate-desktop/mate-bg.c */
-//static cairo_surface_t*
-//create_root_surface (GdkScreen* screen)
-//{
-//	gint number, width, height;
-//	Display *display;
-//	Pixmap pixmap;
-//	cairo_surface_t *surface;
-//
-//	number = gdk_screen_get_number (screen);
-//	width = gdk_screen_get_width (screen);
-//	height = gdk_screen_get_height (screen);
-//
-//    /* Open a new connection so with Retain Permanent so the pixmap remains when the greeter quits */
-//	gdk_flush ();
-//	display = XOpenDisplay (gdk_display_get_name (gdk_screen_get_display (screen)));
-//	if (!display) {
-//		g_warning ("[Background] Failed to create root pixmap");
-//		return NULL;
-//	}
-//
-//	XSetCloseDownMode (display, RetainPermanent);
-//	pixmap = XCreatePixmap (display, RootWindow (display, number), width, height, DefaultDepth (display, number));
-//	XCloseDisplay (display);
-//
-//	/* Convert into a Cairo surface */
-//	surface = cairo_xlib_surface_create (GDK_SCREEN_XDISPLAY (screen),
-//                                         pixmap,
-//                                         GDK_VISUAL_XVISUAL (gdk_screen_get_system_visual (screen)),
-//                                         width, height);
-//
-//	return surface;
-//}
+static cairo_surface_t*
+create_root_surface (GdkScreen* screen)
+{
+	gint number, width, height;
+	Display *display;
+	Pixmap pixmap;
+	cairo_surface_t *surface;
+
+	number = gdk_x11_screen_get_screen_number (screen);
+
+	/* Open a new connection so with Retain Permanent so the pixmap remains when the greeter quits */
+	gdk_flush ();
+	display = XOpenDisplay (gdk_display_get_name (gdk_screen_get_display (screen)));
+	if (!display) {
+		g_warning ("[Background] Failed to create root pixmap");
+		return NULL;
+	}
+
+	/* Root window size is in device pixels */
+	width = DisplayWidth (display, number);
+	height = DisplayHeight (display, number);
+
+	XSetCloseDownMode (display, RetainPermanent);
+	pixmap = XCreatePixmap (display, RootWindow (display, number), width, height, DefaultDepth (display, number));
+	XCloseDisplay (display);
+
+	/* Convert into a Cairo surface */
+	surface = cairo_xlib_surface_create (GDK_SCREEN_XDISPLAY (screen),
+                                         pixmap,
+                                         GDK_VISUAL_XVISUAL (gdk_screen_get_system_visual (screen)),
+                                         width, height);
+
+	return surface;
+}
 
 /* Sets the "ESETROOT_PMAP_ID" property to later be used to free the pixmap */
-//static void
-//set_root_pixmap_id (GdkScreen* screen, Display* display, Pixmap xpixmap)
-//{
-//	Window xroot = RootWindow (display, gdk_screen_get_number (screen));
-//	char *atom_names[] = {"_XROOTPMAP_ID", "ESETROOT_PMAP_ID"};
-//	Atom atoms[G_N_ELEMENTS(atom_names)] = {0};
-//
-//	Atom type;
-//	int format;
-//	unsigned long nitems, after;
-//	unsigned char *data_root, *data_esetroot;
-//
-//	/* Get atoms for both properties in an array, only if they exist.
-//	 * This method is to avoid multiple round-trips to Xserver
-//	 */
-//	if (XInternAtoms (display, atom_names, G_N_ELEMENTS(atom_names), True, atoms) &&
-//        atoms[0] != None && atoms[1] != None) {
-//		XGetWindowProperty (display, xroot, atoms[0], 0L, 1L, False, AnyPropertyType,
-//                            &type, &format, &nitems, &after, &data_root);
-//		if (data_root && type == XA_PIXMAP && format == 32 && nitems == 1) {
-//			XGetWindowProperty (display, xroot, atoms[1], 0L, 1L, False, AnyPropertyType,
-//                                &type, &format, &nitems, &after, &data_esetroot);
-//			if (data_esetroot && type == XA_PIXMAP && format == 32 && nitems == 1) {
-//				Pixmap xrootpmap = *((Pixmap *) data_root);
-//				Pixmap esetrootpmap = *((Pixmap *) data_esetroot);
-//				XFree (data_root);
-//				XFree (data_esetroot);
-//
-//				gdk_error_trap_push ();
-//				if (xrootpmap && xrootpmap == esetrootpmap) {
-//					XKillClient (display, xrootpmap);
-//				}
-//				if (esetrootpmap && esetrootpmap != xrootpmap) {
-//					XKillClient (display, esetrootpmap);
-//				}
-//
-//				XSync (display, False);
-//				gdk_error_trap_pop_ignored ();
-//			}
-//		}
-//	}
-//
-//    /* Get atoms for both properties in an array, create them if needed.
-//     * This method is to avoid multiple round-trips to Xserver
-//     */
-//	if (!XInternAtoms (display, atom_names, G_N_ELEMENTS(atom_names), False, atoms) ||
-//        atoms[0] == None || atoms[1] == None) {
-//		g_warning ("[Background] Could not create atoms needed to set root pixmap id/properties.\n");
-//		return;
-//	}
-//
-//    /* Set new _XROOTMAP_ID and ESETROOT_PMAP_ID properties */
-//	XChangeProperty (display, xroot, atoms[0], XA_PIXMAP, 32,
-//                     PropModeReplace, (unsigned char *) &xpixmap, 1);
-//
-//	XChangeProperty (display, xroot, atoms[1], XA_PIXMAP, 32,
-//                     PropModeReplace, (unsigned char *) &xpixmap, 1);
-//}
+static void
+set_root_pixmap_id (GdkScreen* screen, Display* display, Pixmap xpixmap)
+{
+	Window xroot = RootWindow (display, gdk_x11_screen_get_screen_number (screen));
+	char *atom_names[] = {"_XROOTPMAP_ID", "ESETROOT_PMAP_ID"};
+	Atom atoms[G_N_ELEMENTS(atom_names)] = {0};
+
+	Atom type;
+	int format;
+	unsigned long nitems, after;
+	unsigned char *data_root = NULL, *data_esetroot = NULL;
+
+	/* Get atoms for both properties in an array, only if they exist.
+	 * This method is to avoid multiple round-trips to Xserver
+	 */
+	if (XInternAtoms (display, atom_names, G_N_ELEMENTS(atom_names), True, atoms) &&
+        atoms[0] != None && atoms[1] != None) {
+		XGetWindowProperty (display, xroot, atoms[0], 0L, 1L, False, AnyPropertyType,
+                            &type, &format, &nitems, &after, &data_root);
+		if (data_root && type == XA_PIXMAP && format == 32 && nitems == 1) {
+			XGetWindowProperty (display, xroot, atoms[1], 0L, 1L, False, AnyPropertyType,
+                                &type, &format, &nitems, &after, &data_esetroot);
+			if (data_esetroot && type == XA_PIXMAP && format == 32 && nitems == 1) {
+				Pixmap xrootpmap = *((Pixmap *) data_root);
+				Pixmap esetrootpmap = *((Pixmap *) data_esetroot);
+
+				gdk_x11_display_error_trap_push (gdk_screen_get_display (screen));
+				if (xrootpmap && xrootpmap == esetrootpmap) {
+					XKillClient (display, xrootpmap);
+				}
+				if (esetrootpmap && esetrootpmap != xrootpmap) {
+					XKillClient (display, esetrootpmap);
+				}
+
+				XSync (display, False);
+				gdk_x11_display_error_trap_pop_ignored (gdk_screen_get_display (screen));
+			}
+		}
+		if (data_root)
+			XFree (data_root);
+		if (data_esetroot)
+			XFree (data_esetroot);
+	}
+
+    /* Get atoms for both properties in an array, create them if needed.
+     * This method is to avoid multiple round-trips to Xserver
+     */
+	if (!XInternAtoms (display, atom_names, G_N_ELEMENTS(atom_names), False, atoms) ||
+        atoms[0] == None || atoms[1] == None) {
+		g_warning ("[Background] Could not create atoms needed to set root pixmap id/properties.\n");
+		return;
+	}
+
+    /* Set new _XROOTMAP_ID and ESETROOT_PMAP_ID properties */
+	XChangeProperty (display, xroot, atoms[0], XA_PIXMAP, 32,
+                     PropModeReplace, (unsigned char *) &xpixmap, 1);
+
+	XChangeProperty (display, xroot, atoms[1], XA_PIXMAP, 32,
+                     PropModeReplace, (unsigned char *) &xpixmap, 1);
+}
 
 /**
 * set_surface_as_root:
@@ -1027,24 +2554,78 @@ greeter_background_set_active_monitor_from_geometry (GreeterBackground  *backgro
 * same conventions we do). @surface should come from a call
 * to create_root_surface().
 **/
-//static void
-//set_surface_as_root (GdkScreen* screen, cairo_surface_t* surface)
-//{
-//	g_return_if_fail(cairo_surface_get_type (surface) == CAIRO_SURFACE_TYPE_XLIB);
-//
-//    /* Desktop background pixmap should be created from dummy X client since most
-//     * applications will try to kill it with XKillClient later when changing pixmap
-//     */
-//	Display *display = GDK_DISPLAY_XDISPLAY (gdk_screen_get_display (screen));
-//	Pixmap pixmap_id = cairo_xlib_surface_get_drawable (surface);
-//	Window xroot = RootWindow (display, gdk_screen_get_number(screen));
-//
-//	XGrabServer (display);
-//
-//	XSetWindowBackgroundPixmap (display, xroot, pixmap_id);
-//	set_root_pixmap_id (screen, display, pixmap_id);
-//	XClearWindow (display, xroot);
-//
-//	XFlush (display);
-//	XUngrabServer (display);
-//}
+static void
+set_surface_as_root (GdkScreen* screen, cairo_surface_t* surface)
+{
+	g_return_if_fail(cairo_surface_get_type (surface) == CAIRO_SURFACE_TYPE_XLIB);
+
+    /* Desktop background pixmap should be created from dummy X client since most
+     * applications will try to kill it with XKillClient later when changing pixmap
+     */
+	Display *display = GDK_DISPLAY_XDISPLAY (gdk_screen_get_display (screen));
+	Pixmap pixmap_id = cairo_xlib_surface_get_drawable (surface);
+	Window xroot = RootWindow (display, gdk_x11_screen_get_screen_number (screen));
+
+	XGrabServer (display);
+
+	XSetWindowBackgroundPixmap (display, xroot, pixmap_id);
+	set_root_pixmap_id (screen, display, pixmap_id);
+	XClearWindow (display, xroot);
+
+	XFlush (display);
+	XUngrabServer (display);
+}
+
+/* Publishes the monitor backgrounds as root window pixmap, so the session
+ * starts on the same picture instead of a black root window. Monitors are
+ * painted from the surfaces already prepared for their windows. */
+void
+greeter_background_save_xroot (GreeterBackground* background)
+{
+	gint i;
+	cairo_t* cr;
+	cairo_surface_t* root_surface;
+	gint64 start_time = g_get_monotonic_time ();
+
+	g_return_if_fail (GREETER_IS_BACKGROUND (background));
+
+	GreeterBackgroundPrivate* priv = background->priv;
+
+	if (!priv->screen)
+		return;
+
+	root_surface = create_root_surface (priv->screen);
+	if (!root_surface)
+		return;
+
+	cr = cairo_create (root_surface);
+
+	/* Areas not covered by any monitor */
+	cairo_set_source_rgb (cr, 0.0, 0.0, 0.0);
+	cairo_paint (cr);
+
+	for (i = 0; i < priv->monitors_size; ++i) {
+		const Monitor* monitor = &priv->monitors[i];
+
+		if (!monitor->background)
+			continue;
+
+		/* Monitor geometry is logical, root pixmap is in device pixels */
+		cairo_save (cr);
+		cairo_scale (cr, monitor->scale, monitor->scale);
+		cairo_translate (cr, monitor->geometry.x, monitor->geometry.y);
+		cairo_rectangle (cr, 0, 0, monitor->geometry.width, monitor->geometry.height);
+		cairo_clip (cr);
+		monitor_draw_background (monitor, monitor->background, cr);
+		cairo_restore (cr);
+	}
+
+	cairo_destroy (cr);
+	cairo_surface_flush (root_surface);
+
+	set_surface_as_root (priv->screen, root_surface);
+	cairo_surface_destroy (root_surface);
+
+	g_debug ("[Background] Root pixmap published in %.1f ms",
+             (g_get_monotonic_time () - start_time) / 1000.0);
+}
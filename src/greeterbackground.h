@@ -35,10 +35,21 @@ GType greeter_background_get_type(void) G_GNUC_CONST;
 GreeterBackground* greeter_background_new           (GtkWidget* child);
 
 void greeter_background_set_monitor_config          (GreeterBackground* background,
+                                                     const gchar*       name,
                                                      const gchar*       bg);
+void greeter_background_set_use_pixmap              (GreeterBackground* background,
+                                                     gboolean           use_pixmap);
+void greeter_background_set_placeholder_color       (GreeterBackground* background,
+                                                     const gchar*       color);
+void greeter_background_set_panel_backdrop          (GreeterBackground* background,
+                                                     const gchar*       value);
+void greeter_background_set_scaling_filter          (GreeterBackground* background,
+                                                     const gchar*       value);
+void greeter_background_set_slideshow_interval      (GreeterBackground* background,
+                                                     gint               interval);
 void greeter_background_connect                     (GreeterBackground* background,
                                                      GdkScreen* screen);
-//void greeter_background_save_xroot                  (GreeterBackground* background);
+void greeter_background_save_xroot                  (GreeterBackground* background);
 void greeter_background_add_accel_group             (GreeterBackground* background,
                                                      GtkAccelGroup*     group);
 GdkPixbuf *greeter_background_pixbuf_get            (GreeterBackground* background);
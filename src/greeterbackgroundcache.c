@@ -0,0 +1,491 @@
+/*
+ * Copyright (C) 2015 - 2021 Gooroom <gooroom@gooroom.kr>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version. See http://www.gnu.org/copyleft/gpl.html the full text of the
+ * license.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "greeterbackgroundcache.h"
+
+/* Scaled backgrounds are stored as raw cairo image data, so a cache hit is
+ * only a mmap(): header is followed by "height" rows of "stride" bytes.
+ * Entries in the shared directory (tmpfs) are mapped by every greeter
+ * process of the host, so each image is resident only once. */
+#define CACHE_MAGIC         "GGBGC\001\0\0"
+#define CACHE_SUFFIX        ".bg"
+#define LOCK_SUFFIX         ".lock"
+
+typedef struct
+{
+	gchar magic[8];
+	guint32 format;
+	guint32 width;
+	guint32 height;
+	guint32 stride;
+	guint32 reserved[10];
+} CacheHeader;
+
+G_STATIC_ASSERT (sizeof (CacheHeader) == 64);
+
+typedef struct
+{
+	gchar* filename;
+	gint64 mtime;
+	goffset size;
+} CacheEntry;
+
+struct _BackgroundCacheLock
+{
+	gint fd;
+	gchar* filename;
+};
+
+static gchar* cache_dir = NULL;
+static gchar* shared_dir = NULL;
+/* Read-only entries made by gooroom-greeter-bgprep */
+static const gchar* prebuilt_dir = BACKGROUND_PREBUILT_DIR;
+static gsize cache_max_size = 0;
+
+static const cairo_user_data_key_t mapped_file_key;
+
+G_LOCK_DEFINE_STATIC (cache_trim);
+
+
+static gchar*
+cache_make_dir (const gchar* dir, gint mode)
+{
+	if (!dir || !*dir)
+		return NULL;
+
+	if (g_mkdir_with_parents (dir, mode) < 0) {
+		g_warning ("[Background] Failed to create cache directory %s: %s", dir, g_strerror (errno));
+		return NULL;
+	}
+
+	return g_strdup (dir);
+}
+
+void
+background_cache_init (const gchar* dir, const gchar* shared, gsize max_size)
+{
+	g_free (cache_dir);
+	g_free (shared_dir);
+	cache_dir = NULL;
+	shared_dir = NULL;
+	cache_max_size = max_size;
+
+	if (max_size == 0)
+		return;
+
+	cache_dir = cache_make_dir (dir, 0775);
+	shared_dir = cache_make_dir (shared, 0700);
+}
+
+/* Entry name depends on everything that changes the scaled pixels */
+static gchar*
+cache_entry_name (const gchar* path,
+                  gint         mode,
+                  gint         filter,
+                  gint         width,
+                  gint         height,
+                  gint         scale)
+{
+	GStatBuf st;
+	gchar *key, *checksum, *name;
+
+	if (g_stat (path, &st) != 0)
+		return NULL;
+
+	key = g_strdup_printf ("%s\n%" G_GINT64_FORMAT " %" G_GINT64_FORMAT "\n%d/%d %dx%d@%d",
+                           path, (gint64) st.st_mtime, (gint64) st.st_size,
+                           mode, filter, width, height, scale);
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+	name = g_strconcat (checksum, CACHE_SUFFIX, NULL);
+
+	g_free (checksum);
+	g_free (key);
+
+	return name;
+}
+
+static cairo_surface_t*
+cache_map_entry (const gchar* dir,
+                 const gchar* name,
+                 gint         scale)
+{
+	gsize length;
+	gchar* filename;
+	GMappedFile* mapped;
+	const CacheHeader* header;
+	cairo_surface_t* surface;
+
+	if (!dir)
+		return NULL;
+
+	filename = g_build_filename (dir, name, NULL);
+
+	mapped = g_mapped_file_new (filename, FALSE, NULL);
+	if (!mapped) {
+		g_free (filename);
+		return NULL;
+	}
+
+	header = (const CacheHeader*) g_mapped_file_get_contents (mapped);
+	length = g_mapped_file_get_length (mapped);
+
+	if (length < sizeof (CacheHeader) ||
+	    memcmp (header->magic, CACHE_MAGIC, sizeof (header->magic)) != 0 ||
+	    (header->format != CAIRO_FORMAT_ARGB32 && header->format != CAIRO_FORMAT_RGB24) ||
+	    header->stride != cairo_format_stride_for_width (header->format, header->width) ||
+	    length != sizeof (CacheHeader) + (gsize) header->stride * header->height) {
+		g_warning ("[Background] Removing broken cache entry: %s", filename);
+		g_mapped_file_unref (mapped);
+		g_unlink (filename);
+		g_free (filename);
+		return NULL;
+	}
+
+	surface = cairo_image_surface_create_for_data ((guchar*) header + sizeof (CacheHeader),
+                                                   header->format,
+                                                   header->width,
+                                                   header->height,
+                                                   header->stride);
+	cairo_surface_set_user_data (surface, &mapped_file_key, mapped,
+                                 (cairo_destroy_func_t) g_mapped_file_unref);
+	/* Rows are device pixels */
+	cairo_surface_set_device_scale (surface, scale, scale);
+
+	/* Least recently used entries are evicted first */
+	g_utime (filename, NULL);
+
+	g_free (filename);
+
+	return surface;
+}
+
+cairo_surface_t*
+background_cache_lookup (const gchar* path,
+                         gint         mode,
+                         gint         filter,
+                         gint         width,
+                         gint         height,
+                         gint         scale)
+{
+	gchar* name;
+	cairo_surface_t* surface;
+
+	name = cache_entry_name (path, mode, filter, width, height, scale);
+	if (!name)
+		return NULL;
+
+	surface = cache_map_entry (shared_dir, name, scale);
+	if (surface)
+		g_debug ("[Background] Shared cache hit: %s (%dx%d@%d)", path, width, height, scale);
+	else if ((surface = cache_map_entry (prebuilt_dir, name, scale)))
+		g_debug ("[Background] Prebuilt cache hit: %s (%dx%d@%d)", path, width, height, scale);
+	else if ((surface = cache_map_entry (cache_dir, name, scale)))
+		g_debug ("[Background] Cache hit: %s (%dx%d@%d)", path, width, height, scale);
+
+	g_free (name);
+
+	return surface;
+}
+
+gboolean
+background_cache_is_mapped (cairo_surface_t* surface)
+{
+	return cairo_surface_get_user_data (surface, &mapped_file_key) != NULL;
+}
+
+BackgroundCacheLock*
+background_cache_lock (const gchar* path,
+                       gint         mode,
+                       gint         filter,
+                       gint         width,
+                       gint         height,
+                       gint         scale)
+{
+	gint fd;
+	gchar *name, *filename;
+	BackgroundCacheLock* lock;
+
+	if (!shared_dir && !cache_dir)
+		return NULL;
+
+	name = cache_entry_name (path, mode, filter, width, height, scale);
+	if (!name)
+		return NULL;
+
+	filename = g_strconcat (shared_dir ? shared_dir : cache_dir, G_DIR_SEPARATOR_S, name, LOCK_SUFFIX, NULL);
+	g_free (name);
+
+	for (;;) {
+		GStatBuf st;
+		struct stat fd_st;
+
+		fd = g_open (filename, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+		if (fd < 0) {
+			g_free (filename);
+			return NULL;
+		}
+
+		while (flock (fd, LOCK_EX) < 0) {
+			if (errno != EINTR) {
+				close (fd);
+				g_free (filename);
+				return NULL;
+			}
+		}
+
+		if (fstat (fd, &fd_st) < 0) {
+			close (fd);
+			g_free (filename);
+			return NULL;
+		}
+
+		/* The holder unlinks the file before releasing it, a lock on an
+		 * unlinked file excludes nobody opening the name now */
+		if (g_stat (filename, &st) == 0 && st.st_dev == fd_st.st_dev && st.st_ino == fd_st.st_ino)
+			break;
+
+		close (fd);
+	}
+
+	lock = g_new0 (BackgroundCacheLock, 1);
+	lock->fd = fd;
+	lock->filename = filename;
+
+	return lock;
+}
+
+void
+background_cache_unlock (BackgroundCacheLock* lock)
+{
+	if (!lock)
+		return;
+
+	/* Waiting processes find their file unlinked and open it again, then
+	 * check the cache again, so the entry is already there */
+	g_unlink (lock->filename);
+	close (lock->fd);
+	g_free (lock->filename);
+	g_free (lock);
+}
+
+static gboolean
+write_all (gint fd, gconstpointer data, gsize size)
+{
+	const guchar* p = data;
+
+	while (size > 0) {
+		gssize written = write (fd, p, size);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			return FALSE;
+		}
+		p += written;
+		size -= written;
+	}
+
+	return TRUE;
+}
+
+static gint
+cache_entry_compare (gconstpointer a, gconstpointer b)
+{
+	const CacheEntry* entry_a = *(const CacheEntry**) a;
+	const CacheEntry* entry_b = *(const CacheEntry**) b;
+
+	return (entry_a->mtime > entry_b->mtime) - (entry_a->mtime < entry_b->mtime);
+}
+
+static void
+cache_entry_free (CacheEntry* entry)
+{
+	g_free (entry->filename);
+	g_free (entry);
+}
+
+/* Removes least recently used entries until the cache fits into its budget */
+static void
+background_cache_trim (const gchar* path)
+{
+	GDir* dir;
+	guint i;
+	goffset total = 0;
+	const gchar* name;
+	GPtrArray* entries;
+
+	if (cache_max_size == BACKGROUND_CACHE_UNLIMITED)
+		return;
+
+	G_LOCK (cache_trim);
+
+	dir = g_dir_open (path, 0, NULL);
+	if (!dir) {
+		G_UNLOCK (cache_trim);
+		return;
+	}
+
+	entries = g_ptr_array_new_with_free_func ((GDestroyNotify) cache_entry_free);
+
+	while ((name = g_dir_read_name (dir))) {
+		GStatBuf st;
+		CacheEntry* entry;
+		gchar* filename;
+
+		if (!g_str_has_suffix (name, CACHE_SUFFIX))
+			continue;
+
+		filename = g_build_filename (path, name, NULL);
+		if (g_stat (filename, &st) != 0) {
+			g_free (filename);
+			continue;
+		}
+
+		entry = g_new0 (CacheEntry, 1);
+		entry->filename = filename;
+		entry->mtime = st.st_mtime;
+		entry->size = st.st_size;
+		g_ptr_array_add (entries, entry);
+
+		total += st.st_size;
+	}
+	g_dir_close (dir);
+
+	g_ptr_array_sort (entries, cache_entry_compare);
+
+	/* Most recent entry is always kept */
+	for (i = 0; i + 1 < entries->len && (guint64) total > cache_max_size; ++i) {
+		CacheEntry* entry = g_ptr_array_index (entries, i);
+
+		g_debug ("[Background] Evicting cache entry: %s", entry->filename);
+		if (g_unlink (entry->filename) == 0)
+			total -= entry->size;
+	}
+
+	g_ptr_array_unref (entries);
+
+	G_UNLOCK (cache_trim);
+}
+
+void
+background_cache_clear (void)
+{
+	GDir* dir;
+	const gchar* name;
+
+	if (!cache_dir || !(dir = g_dir_open (cache_dir, 0, NULL)))
+		return;
+
+	while ((name = g_dir_read_name (dir))) {
+		if (g_str_has_suffix (name, CACHE_SUFFIX)) {
+			gchar* filename = g_build_filename (cache_dir, name, NULL);
+			g_unlink (filename);
+			g_free (filename);
+		}
+	}
+
+	g_dir_close (dir);
+}
+
+static gboolean
+cache_write_entry (const gchar*       dir,
+                   const gchar*       name,
+                   const CacheHeader* header,
+                   cairo_surface_t*   image)
+{
+	gint fd;
+	gboolean written;
+	gchar *filename, *tmp_filename;
+
+	filename = g_build_filename (dir, name, NULL);
+
+	/* Write to a temporary file first, so readers never see partial entries */
+	tmp_filename = g_strconcat (filename, ".XXXXXX", NULL);
+	fd = g_mkstemp (tmp_filename);
+	if (fd < 0) {
+		g_warning ("[Background] Failed to create cache entry %s: %s", tmp_filename, g_strerror (errno));
+		g_free (tmp_filename);
+		g_free (filename);
+		return FALSE;
+	}
+
+	/* Prebuilt entries are written by root and read by the greeter user */
+	fchmod (fd, 0644);
+
+	written = write_all (fd, header, sizeof (*header)) &&
+	          write_all (fd, cairo_image_surface_get_data (image), (gsize) header->stride * header->height);
+	close (fd);
+
+	if (!written || g_rename (tmp_filename, filename) != 0) {
+		g_warning ("[Background] Failed to write cache entry %s: %s", filename, g_strerror (errno));
+		g_unlink (tmp_filename);
+		written = FALSE;
+	}
+
+	g_free (tmp_filename);
+	g_free (filename);
+
+	background_cache_trim (dir);
+
+	return written;
+}
+
+cairo_surface_t*
+background_cache_store (const gchar*     path,
+                        gint             mode,
+                        gint             filter,
+                        gint             width,
+                        gint             height,
+                        gint             scale,
+                        cairo_surface_t* image)
+{
+	gchar* name;
+	CacheHeader header = {{0}};
+	cairo_surface_t* surface = NULL;
+
+	g_return_val_if_fail (cairo_surface_get_type (image) == CAIRO_SURFACE_TYPE_IMAGE, NULL);
+
+	if (!shared_dir && !cache_dir)
+		return NULL;
+
+	name = cache_entry_name (path, mode, filter, width, height, scale);
+	if (!name)
+		return NULL;
+
+	cairo_surface_flush (image);
+
+	memcpy (header.magic, CACHE_MAGIC, sizeof (header.magic));
+	header.format = cairo_image_surface_get_format (image);
+	header.width = cairo_image_surface_get_width (image);
+	header.height = cairo_image_surface_get_height (image);
+	header.stride = cairo_image_surface_get_stride (image);
+
+	if (cache_dir && cache_write_entry (cache_dir, name, &header, image) && !shared_dir)
+		surface = cache_map_entry (cache_dir, name, scale);
+
+	if (shared_dir && cache_write_entry (shared_dir, name, &header, image))
+		surface = cache_map_entry (shared_dir, name, scale);
+
+	g_free (name);
+
+	return surface;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2015 - 2021 Gooroom <gooroom@gooroom.kr>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version. See http://www.gnu.org/copyleft/gpl.html the full text of the
+ * license.
+ */
+
+
+#ifndef GREETER_BACKGROUND_CACHE_H
+#define GREETER_BACKGROUND_CACHE_H
+
+#include <glib.h>
+#include <cairo.h>
+
+G_BEGIN_DECLS
+
+typedef struct _BackgroundCacheLock BackgroundCacheLock;
+
+/* Budget of background_cache_init() that never evicts entries */
+#define BACKGROUND_CACHE_UNLIMITED G_MAXSIZE
+
+/* "shared" is a directory on tmpfs used by all greeter processes */
+void             background_cache_init   (const gchar*     dir,
+                                          const gchar*     shared,
+                                          gsize            max_size);
+
+cairo_surface_t* background_cache_lookup (const gchar*     path,
+                                          gint             mode,
+                                          gint             filter,
+                                          gint             width,
+                                          gint             height,
+                                          gint             scale);
+/* Returns the stored entry mapped in place of "image", NULL on failure */
+cairo_surface_t* background_cache_store  (const gchar*     path,
+                                          gint             mode,
+                                          gint             filter,
+                                          gint             width,
+                                          gint             height,
+                                          gint             scale,
+                                          cairo_surface_t* image);
+
+/* Removes all entries of the private cache directory */
+void             background_cache_clear  (void);
+
+/* TRUE for surfaces returned by lookup and store, backed by a cache file */
+gboolean         background_cache_is_mapped (cairo_surface_t* surface);
+
+/* Serializes filling one entry between processes, lookup again once locked */
+BackgroundCacheLock* background_cache_lock   (const gchar*     path,
+                                              gint             mode,
+                                              gint             filter,
+                                              gint             width,
+                                              gint             height,
+                                              gint             scale);
+void                 background_cache_unlock (BackgroundCacheLock* lock);
+
+G_END_DECLS
+
+#endif
@@ -21,6 +21,7 @@
 static GKeyFile* greeter_config = NULL;
 static GKeyFile* state_config = NULL;
 static gchar* state_filename = NULL;
+static gchar* state_config_dir = NULL;
 
 static GKeyFile* get_file_for_group (const gchar** group);
 static void save_key_file           (GKeyFile* config, const gchar* path);
@@ -72,21 +73,9 @@ append_directory_content(GList* files, const gchar* path)
 }
 
 void
-config_init(void)
+config_init_files(void)
 {
     GError* error = NULL;
-
-    gchar* state_config_dir = g_build_filename(g_get_user_cache_dir(), "lightdm-gtk-greeter", NULL);
-    state_filename = g_build_filename(state_config_dir, "state", NULL);
-    g_mkdir_with_parents(state_config_dir, 0775);
-    g_free(state_config_dir);
-
-    state_config = g_key_file_new();
-    g_key_file_load_from_file(state_config, state_filename, G_KEY_FILE_NONE, &error);
-    if (error && !g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
-        g_warning("[Configuration] Failed to load state from %s: %s", state_filename, error->message);
-    g_clear_error(&error);
-
     GList* files = NULL;
 
     gchar *config_path_tmp = g_path_get_dirname(CONFIG_FILE);
@@ -165,6 +154,30 @@ config_init(void)
         greeter_config = g_key_file_new();
 }
 
+void
+config_init(void)
+{
+    GError* error = NULL;
+
+    state_config_dir = g_build_filename(g_get_user_cache_dir(), "lightdm-gtk-greeter", NULL);
+    state_filename = g_build_filename(state_config_dir, "state", NULL);
+    g_mkdir_with_parents(state_config_dir, 0775);
+
+    state_config = g_key_file_new();
+    g_key_file_load_from_file(state_config, state_filename, G_KEY_FILE_NONE, &error);
+    if (error && !g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        g_warning("[Configuration] Failed to load state from %s: %s", state_filename, error->message);
+    g_clear_error(&error);
+
+    config_init_files();
+}
+
+const gchar*
+config_get_state_dir(void)
+{
+    return state_config_dir;
+}
+
 static GKeyFile*
 get_file_for_group(const gchar** group)
 {
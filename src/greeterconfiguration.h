@@ -17,6 +17,7 @@
 
 
 #define CONFIG_GROUP_DEFAULT            "greeter"
+#define CONFIG_GROUP_MONITOR            "monitor:"
 #define CONFIG_KEY_INDICATORS           "indicators"
 #define CONFIG_KEY_DEBUGGING            "allow-debugging"
 #define CONFIG_KEY_THEME                "theme-name"
@@ -28,10 +29,22 @@
 #define CONFIG_KEY_RGBA                 "xft-rgba"
 #define CONFIG_KEY_KEYBOARD             "keyboard"
 #define CONFIG_KEY_BACKGROUND           "background"
+#define CONFIG_KEY_BACKGROUND_PIXMAP    "background-pixmap"
+#define CONFIG_KEY_BACKGROUND_PLACEHOLDER "background-placeholder"
+#define CONFIG_KEY_BACKGROUND_CACHE_SIZE "background-cache-size"
+#define CONFIG_KEY_BACKGROUND_SHARED_CACHE "background-shared-cache"
+#define CONFIG_KEY_BACKGROUND_FILTER    "background-filter"
+#define CONFIG_KEY_BACKGROUND_SLIDESHOW_INTERVAL "background-slideshow-interval"
+#define CONFIG_KEY_PANEL_BACKDROP       "panel-backdrop"
+#define CONFIG_KEY_PREAUTHENTICATE      "preauthenticate"
+#define CONFIG_KEY_PAM_MESSAGES         "pam-messages"
 #define STATE_SECTION_GREETER           "/greeter"
 
 
 void config_init                (void);
+/* Configuration files only, without the greeter state in the user cache dir */
+void config_init_files          (void);
+const gchar* config_get_state_dir (void);
 
 gchar** config_get_groups       (const gchar* prefix);
 gboolean config_has_key         (const gchar* group, const gchar* key);
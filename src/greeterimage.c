@@ -0,0 +1,461 @@
+/*
+ * Copyright (C) 2015 - 2021 Gooroom <gooroom@gooroom.kr>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version. See http://www.gnu.org/copyleft/gpl.html the full text of the
+ * license.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include "greeterimage.h"
+#include "greeterqoi.h"
+
+static const gchar* SCALING_MODE_PREFIXES[] = {
+	"#source:", "#zoomed:", "#scaled:", "#stretched:", "#spanned:", NULL };
+
+
+const gchar*
+image_parse_scaling_mode (const gchar* value, ScalingMode* mode)
+{
+	const gchar** prefix = SCALING_MODE_PREFIXES;
+
+	while (*prefix && !g_str_has_prefix (value, *prefix))
+		++prefix;
+
+	if (!*prefix) {
+		*mode = SCALING_MODE_ZOOMED;
+		return value;
+	}
+
+	*mode = (ScalingMode)(prefix - SCALING_MODE_PREFIXES);
+	return value + strlen (*prefix);
+}
+
+void
+image_parse_scaling_filters (const gchar* value, ScalerFilter filters[SCALING_MODE_COUNT])
+{
+	gchar** items;
+	gchar** item;
+	guint i;
+
+	for (i = 0; i < SCALING_MODE_COUNT; ++i)
+		filters[i] = SCALER_FILTER_AREA;
+
+	if (!value)
+		return;
+
+	items = g_strsplit (value, ";", -1);
+	for (item = items; *item; ++item) {
+		gchar* name = g_strstrip (*item);
+		gchar* separator = strchr (name, ':');
+		ScalerFilter filter;
+
+		if (*name == '\0')
+			continue;
+
+		if (!scaler_filter_from_string (separator ? separator + 1 : name, &filter)) {
+			g_warning ("[Background] Unknown scaling filter: %s", name);
+			continue;
+		}
+
+		if (!separator) {
+			for (i = 0; i < SCALING_MODE_COUNT; ++i)
+				filters[i] = filter;
+			continue;
+		}
+
+		for (i = 0; SCALING_MODE_PREFIXES[i]; ++i) {
+			/* Prefixes are "#mode:" */
+			if (strncmp (SCALING_MODE_PREFIXES[i] + 1, name, separator - name + 1) == 0)
+				break;
+		}
+
+		if (SCALING_MODE_PREFIXES[i])
+			filters[i] = filter;
+		else
+			g_warning ("[Background] Unknown scaling mode: %s", name);
+	}
+	g_strfreev (items);
+}
+
+/* Same geometry as image_scale(), but resampled with the built-in scaler */
+static GdkPixbuf*
+image_scale_filtered (GdkPixbuf* source, ScalingMode mode, gint width, gint height, ScalerFilter filter)
+{
+	gint p_width = gdk_pixbuf_get_width (source);
+	gint p_height = gdk_pixbuf_get_height (source);
+
+	if (mode == SCALING_MODE_ZOOMED || mode == SCALING_MODE_SPANNED) {
+		gdouble factor = MAX (width/(gdouble)p_width, height/(gdouble)p_height);
+		gint new_width = MAX (width, floor (p_width * factor + 0.5));
+		gint new_height = MAX (height, floor (p_height * factor + 0.5));
+		GdkPixbuf *scaled, *area, *pixbuf;
+
+		scaled = scaler_scale_pixbuf (source, new_width, new_height, filter, SCALER_KERNEL_AUTO);
+		if (!scaled)
+			return NULL;
+
+		area = gdk_pixbuf_new_subpixbuf (scaled, (new_width - width) / 2, (new_height - height) / 2,
+                                         width, height);
+		pixbuf = gdk_pixbuf_copy (area);
+
+		g_object_unref (area);
+		g_object_unref (scaled);
+
+		return pixbuf;
+	}
+
+	if (mode == SCALING_MODE_SCALED) {
+		gdouble factor = MIN (width/(gdouble)p_width, height/(gdouble)p_height);
+		gint new_width = MAX (1, floor (p_width * factor + 0.5));
+		gint new_height = MAX (1, floor (p_height * factor + 0.5));
+		GdkPixbuf *scaled, *pixbuf;
+
+		scaled = scaler_scale_pixbuf (source, new_width, new_height, filter, SCALER_KERNEL_AUTO);
+		if (!scaled)
+			return NULL;
+
+		pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, gdk_pixbuf_get_has_alpha (scaled), 8, width, height);
+		gdk_pixbuf_fill (pixbuf, 0);
+		gdk_pixbuf_copy_area (scaled, 0, 0, new_width, new_height, pixbuf,
+                              (width - new_width) / 2, (height - new_height) / 2);
+
+		g_object_unref (scaled);
+
+		return pixbuf;
+	}
+
+	if (mode == SCALING_MODE_STRETCHED)
+		return scaler_scale_pixbuf (source, width, height, filter, SCALER_KERNEL_AUTO);
+
+	return GDK_PIXBUF (g_object_ref (source));
+}
+
+GdkPixbuf*
+image_scale (GdkPixbuf* source, ScalingMode mode, gint width, gint height, ScalerFilter filter)
+{
+	if (filter != SCALER_FILTER_BILINEAR)
+		return image_scale_filtered (source, mode, width, height, filter);
+
+	if(mode == SCALING_MODE_ZOOMED || mode == SCALING_MODE_SPANNED) {
+		gint offset_x = 0;
+		gint offset_y = 0;
+		gint p_width = gdk_pixbuf_get_width(source);
+		gint p_height = gdk_pixbuf_get_height(source);
+		gdouble scale_x = (gdouble)width / p_width;
+		gdouble scale_y = (gdouble)height / p_height;
+
+		if(scale_x < scale_y) {
+			scale_x = scale_y;
+			offset_x = (width - (p_width * scale_x)) / 2;
+		} else {
+			scale_y = scale_x;
+			offset_y = (height - (p_height * scale_y)) / 2;
+		}
+
+		/* Opaque sources stay without alpha channel */
+		GdkPixbuf *pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, gdk_pixbuf_get_has_alpha (source),
+                                            gdk_pixbuf_get_bits_per_sample (source),
+                                            width, height);
+		gdk_pixbuf_scale (source, pixbuf, 0, 0, width, height,
+                          offset_x, offset_y, scale_x, scale_y, GDK_INTERP_BILINEAR);
+		return pixbuf;
+	}
+
+	if (mode == SCALING_MODE_SCALED) {
+		gdouble factor;
+		gint p_width, p_height;
+		gint new_width, new_height;
+		gint offset_x, offset_y;
+
+		p_width = gdk_pixbuf_get_width (source);
+		p_height = gdk_pixbuf_get_height (source);
+
+		factor = MIN (width/(gdouble)p_width, height/(gdouble)p_height);
+
+		offset_x = (width - (p_width * factor)) / 2;
+		offset_y = (height - (p_height * factor)) / 2;
+
+		new_width  = floor (p_width * factor + 0.5);
+		new_height = floor (p_height * factor + 0.5);
+
+		GdkPixbuf *new = gdk_pixbuf_scale_simple (source, new_width, new_height, GDK_INTERP_BILINEAR);
+
+		GdkPixbuf *pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, gdk_pixbuf_get_has_alpha (source),
+                                            gdk_pixbuf_get_bits_per_sample (source),
+                                            width, height);
+		gdk_pixbuf_fill (pixbuf, 0);
+
+		gdk_pixbuf_copy_area (new, 0, 0, new_width, new_height, pixbuf, offset_x, offset_y);
+
+		g_object_unref (new);
+
+		return pixbuf;
+	}
+
+	if (mode == SCALING_MODE_STRETCHED)
+		return gdk_pixbuf_scale_simple (source, width, height, GDK_INTERP_BILINEAR);
+
+	return GDK_PIXBUF (g_object_ref (source));
+}
+
+/* Backgrounds are opaque: images are kept as RGB24 surfaces, sources with
+ * alpha channel are flattened on black like the windows showed them.
+ * Converted here rather than with GDK, so the pre-render tool needs no display. */
+cairo_surface_t*
+image_surface_from_pixbuf (GdkPixbuf* pixbuf, gint scale)
+{
+	gint x, y;
+	cairo_surface_t* surface;
+	gint width = gdk_pixbuf_get_width (pixbuf);
+	gint height = gdk_pixbuf_get_height (pixbuf);
+	gint channels = gdk_pixbuf_get_n_channels (pixbuf);
+	gint src_stride = gdk_pixbuf_get_rowstride (pixbuf);
+	const guchar* src_pixels = gdk_pixbuf_read_pixels (pixbuf);
+	guchar* dest_pixels;
+	gint dest_stride;
+
+	surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24, width, height);
+	if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)
+		return surface;
+
+	dest_pixels = cairo_image_surface_get_data (surface);
+	dest_stride = cairo_image_surface_get_stride (surface);
+
+	for (y = 0; y < height; ++y) {
+		const guchar* src = src_pixels + (gsize) y * src_stride;
+		guint32* dest = (guint32*) (dest_pixels + (gsize) y * dest_stride);
+
+		if (channels == 4) {
+			for (x = 0; x < width; ++x, src += 4) {
+				guint a = src[3];
+				dest[x] = (((src[0] * a + 127) / 255) << 16) |
+				          (((src[1] * a + 127) / 255) << 8) |
+				          ((src[2] * a + 127) / 255);
+			}
+		} else {
+			for (x = 0; x < width; ++x, src += 3)
+				dest[x] = (src[0] << 16) | (src[1] << 8) | src[2];
+		}
+	}
+
+	cairo_surface_mark_dirty (surface);
+	cairo_surface_set_device_scale (surface, scale, scale);
+
+	return surface;
+}
+
+/* Largest JPEG DCT scale denominator (1, 2, 4 or 8) that still gives at least
+ * as many pixels as image_scale() needs for the given target */
+static gint
+image_decode_denominator (gint src_width, gint src_height,
+                          ScalingMode mode, gint width, gint height)
+{
+	gdouble factor;
+	gint need_width, need_height;
+	gint denom;
+
+	switch (mode) {
+		case SCALING_MODE_ZOOMED:
+		case SCALING_MODE_SPANNED:
+			factor = MAX (width/(gdouble)src_width, height/(gdouble)src_height);
+			need_width = ceil (src_width * factor);
+			need_height = ceil (src_height * factor);
+			break;
+		case SCALING_MODE_SCALED:
+			factor = MIN (width/(gdouble)src_width, height/(gdouble)src_height);
+			need_width = ceil (src_width * factor);
+			need_height = ceil (src_height * factor);
+			break;
+		case SCALING_MODE_STRETCHED:
+			need_width = width;
+			need_height = height;
+			break;
+		default:
+			return 1;
+	}
+
+	for (denom = 8; denom > 1; denom /= 2) {
+		/* Same rounding as jpeg_calc_output_dimensions() */
+		if ((src_width + denom - 1) / denom >= need_width &&
+		    (src_height + denom - 1) / denom >= need_height)
+			break;
+	}
+
+	return denom;
+}
+
+/* Extension check only, the file is not opened */
+gboolean
+image_file_is_supported (const gchar* path)
+{
+	GSList* formats;
+	GSList* item;
+	gboolean supported = FALSE;
+	const gchar* extension = strrchr (path, '.');
+
+	if (qoi_file_has_extension (path))
+		return TRUE;
+
+	if (!extension)
+		return FALSE;
+
+	formats = gdk_pixbuf_get_formats ();
+	for (item = formats; item && !supported; item = g_slist_next (item)) {
+		gchar** extensions = gdk_pixbuf_format_get_extensions (item->data);
+		gchar** ext;
+
+		for (ext = extensions; *ext && !supported; ++ext)
+			supported = g_ascii_strcasecmp (*ext, extension + 1) == 0;
+		g_strfreev (extensions);
+	}
+	g_slist_free (formats);
+
+	return supported;
+}
+
+static gint
+image_compare_paths (gconstpointer a, gconstpointer b)
+{
+	return g_strcmp0 (*(const gchar**) a, *(const gchar**) b);
+}
+
+/* Slideshow images: sorted image files of a directory or paths of a ";"
+ * separated list. NULL for a single image. */
+gchar**
+image_list_slides (const gchar* value)
+{
+	GDir* dir;
+	GPtrArray* files;
+	const gchar* name;
+
+	if (strchr (value, ';')) {
+		gchar** items = g_strsplit (value, ";", -1);
+		gchar** item;
+
+		files = g_ptr_array_new ();
+		for (item = items; *item; ++item) {
+			if (*g_strstrip (*item))
+				g_ptr_array_add (files, g_strdup (*item));
+		}
+		g_strfreev (items);
+	} else {
+		if (!g_file_test (value, G_FILE_TEST_IS_DIR))
+			return NULL;
+
+		dir = g_dir_open (value, 0, NULL);
+		if (!dir)
+			return NULL;
+
+		files = g_ptr_array_new ();
+		while ((name = g_dir_read_name (dir))) {
+			gchar* path;
+
+			if (name[0] == '.' || !image_file_is_supported (name))
+				continue;
+
+			path = g_build_filename (value, name, NULL);
+			if (g_file_test (path, G_FILE_TEST_IS_REGULAR))
+				g_ptr_array_add (files, path);
+			else
+				g_free (path);
+		}
+		g_dir_close (dir);
+
+		g_ptr_array_sort (files, image_compare_paths);
+	}
+
+	g_ptr_array_add (files, NULL);
+
+	return (gchar**) g_ptr_array_free (files, FALSE);
+}
+
+/* Decodes source image, JPEG files are decoded directly at the smallest
+ * power-of-two size that covers the target, QOI files by the built-in decoder */
+GdkPixbuf*
+image_load_file (const gchar* path, ScalingMode mode, gint width, gint height, GHashTable* cache)
+{
+	gint denom = 1;
+	gint src_width, src_height;
+	gchar* key;
+	GError* error = NULL;
+	GdkPixbuf* pixbuf = NULL;
+	GdkPixbufFormat* format;
+
+	format = qoi_file_has_extension (path) ? NULL : gdk_pixbuf_get_file_info (path, &src_width, &src_height);
+	if (format && src_width > 0 && src_height > 0) {
+		gchar* name = gdk_pixbuf_format_get_name (format);
+		if (g_strcmp0 (name, "jpeg") == 0)
+			denom = image_decode_denominator (src_width, src_height, mode, width, height);
+		g_free (name);
+	}
+
+	key = g_strdup_printf ("%s\n1/%d", path, denom);
+
+	if (cache && g_hash_table_lookup_extended (cache, key, NULL, (gpointer*)&pixbuf)) {
+		g_free (key);
+		return GDK_PIXBUF (g_object_ref (pixbuf));
+	}
+
+	/* Requested size matches libjpeg output exactly, so the loader
+	 * picks this denominator and does not rescale the result */
+	if (qoi_file_has_extension (path))
+		pixbuf = qoi_load_pixbuf (path, &error);
+	else if (denom > 1)
+		pixbuf = gdk_pixbuf_new_from_file_at_scale (path,
+                                                    (src_width + denom - 1) / denom,
+                                                    (src_height + denom - 1) / denom,
+                                                    FALSE, &error);
+	else
+		pixbuf = gdk_pixbuf_new_from_file (path, &error);
+
+	if (error) {
+		g_warning ("[Background] Failed to load background: %s", error->message);
+		g_clear_error (&error);
+	} else {
+		g_debug ("[Background] Decoded %s at 1/%d: %dx%d", path, denom,
+                 gdk_pixbuf_get_width (pixbuf), gdk_pixbuf_get_height (pixbuf));
+		if (cache)
+			g_hash_table_insert (cache, g_strdup (key), g_object_ref (pixbuf));
+	}
+
+	g_free (key);
+
+	return pixbuf;
+}
+
+/* Cheap preview: JPEG files decoded at 1/8 with DCT scaling, NULL for other
+ * formats or when the image itself is decoded at 1/8 anyway */
+GdkPixbuf*
+image_load_preview (const gchar* path, ScalingMode mode, gint width, gint height)
+{
+	gint src_width, src_height;
+	gchar* name;
+	gboolean jpeg;
+	GdkPixbufFormat* format;
+
+	if (qoi_file_has_extension (path))
+		return NULL;
+
+	format = gdk_pixbuf_get_file_info (path, &src_width, &src_height);
+	if (!format || src_width <= 0 || src_height <= 0)
+		return NULL;
+
+	name = gdk_pixbuf_format_get_name (format);
+	jpeg = g_strcmp0 (name, "jpeg") == 0;
+	g_free (name);
+
+	if (!jpeg || image_decode_denominator (src_width, src_height, mode, width, height) == 8)
+		return NULL;
+
+	return gdk_pixbuf_new_from_file_at_scale (path, (src_width + 7) / 8, (src_height + 7) / 8,
+                                              FALSE, NULL);
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2015 - 2021 Gooroom <gooroom@gooroom.kr>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version. See http://www.gnu.org/copyleft/gpl.html the full text of the
+ * license.
+ */
+
+
+#ifndef GREETER_IMAGE_H
+#define GREETER_IMAGE_H
+
+#include <glib.h>
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "greeterscaler.h"
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+    /* It is not really useful, used for debugging */
+	SCALING_MODE_SOURCE,
+    /* Default mode for values without mode prefix */
+	SCALING_MODE_ZOOMED,
+	SCALING_MODE_SCALED,
+	SCALING_MODE_STRETCHED,
+    /* Zoomed to the bounding box of all monitors, monitors show their part of it */
+	SCALING_MODE_SPANNED
+} ScalingMode;
+
+#define SCALING_MODE_COUNT (SCALING_MODE_SPANNED + 1)
+
+/* Background image decoding and scaling, shared by the greeter and the
+ * offline pre-render tool, so both produce identical cache entries */
+
+/* Strips "#mode:" prefix of a background= path, zoomed if there is none */
+const gchar*     image_parse_scaling_mode    (const gchar*  value,
+                                              ScalingMode*  mode);
+/* Filter name for all modes or "mode:filter" list, e.g. "zoomed:area;stretched:bilinear" */
+void             image_parse_scaling_filters (const gchar*  value,
+                                              ScalerFilter  filters[SCALING_MODE_COUNT]);
+
+gboolean         image_file_is_supported     (const gchar*  path);
+/* Files of a slideshow directory or ";" list, NULL for a single image */
+gchar**          image_list_slides           (const gchar*  value);
+
+/* "cache" (may be NULL) shares decoded sources between targets */
+GdkPixbuf*       image_load_file             (const gchar*  path,
+                                              ScalingMode   mode,
+                                              gint          width,
+                                              gint          height,
+                                              GHashTable*   cache);
+GdkPixbuf*       image_load_preview          (const gchar*  path,
+                                              ScalingMode   mode,
+                                              gint          width,
+                                              gint          height);
+GdkPixbuf*       image_scale                 (GdkPixbuf*    source,
+                                              ScalingMode   mode,
+                                              gint          width,
+                                              gint          height,
+                                              ScalerFilter  filter);
+cairo_surface_t* image_surface_from_pixbuf   (GdkPixbuf*    pixbuf,
+                                              gint          scale);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2015 - 2021 Gooroom <gooroom@gooroom.kr>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version. See http://www.gnu.org/copyleft/gpl.html the full text of the
+ * license.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "greeterlayout.h"
+
+static gboolean
+layout_rectangle_equal (const cairo_rectangle_int_t* a, const cairo_rectangle_int_t* b)
+{
+	return a->x == b->x && a->y == b->y && a->width == b->width && a->height == b->height;
+}
+
+void
+layout_mark_skipped (LayoutMonitor* monitors, gsize monitors_size)
+{
+	gsize i;
+	cairo_region_t* region = cairo_region_create ();
+
+	/* Simple check to skip fully overlapped monitors.
+	   Actually, it's can track only monitors in "mirrors" mode. Nothing more. */
+	for (i = 0; i < monitors_size; ++i) {
+		LayoutMonitor* monitor = &monitors[i];
+
+		monitor->skipped = cairo_region_contains_rectangle (region, &monitor->geometry) == CAIRO_REGION_OVERLAP_IN;
+		if (!monitor->skipped)
+			cairo_region_union_rectangle (region, &monitor->geometry);
+	}
+
+	cairo_region_destroy (region);
+}
+
+/* Old monitor with a window nobody took yet: same output and geometry first, then the same output */
+static gint
+layout_find_match (const LayoutMonitor* old_monitors,
+                   gsize                old_monitors_size,
+                   const gboolean*      available,
+                   const LayoutMonitor* monitor)
+{
+	gint pass;
+	gsize i;
+
+	for (pass = 0; pass < 2; ++pass) {
+		for (i = 0; i < old_monitors_size; ++i) {
+			if (!available[i])
+				continue;
+
+			if (g_strcmp0 (old_monitors[i].name, monitor->name) != 0)
+				continue;
+
+			if (pass == 0 && !layout_rectangle_equal (&old_monitors[i].geometry, &monitor->geometry))
+				continue;
+
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+LayoutDiff*
+layout_diff (const LayoutMonitor* old_monitors,
+             gsize                old_monitors_size,
+             const LayoutMonitor* monitors,
+             gsize                monitors_size)
+{
+	gsize i;
+	LayoutDiff* diff = g_new0 (LayoutDiff, 1);
+
+	diff->changes = g_new0 (LayoutChange, monitors_size);
+	diff->sources = g_new (gint, monitors_size);
+	diff->removed = g_new0 (gboolean, old_monitors_size);
+
+	/* Old monitors keep this until a new one takes their window */
+	for (i = 0; i < old_monitors_size; ++i)
+		diff->removed[i] = !old_monitors[i].skipped;
+
+	for (i = 0; i < monitors_size; ++i) {
+		const LayoutMonitor* monitor = &monitors[i];
+		gint source = -1;
+
+		if (monitor->skipped) {
+			diff->changes[i] = LAYOUT_CHANGE_SKIPPED;
+		} else {
+			source = layout_find_match (old_monitors, old_monitors_size, diff->removed, monitor);
+			if (source < 0) {
+				diff->changes[i] = LAYOUT_CHANGE_CREATED;
+				diff->created++;
+			} else if (layout_rectangle_equal (&old_monitors[source].geometry, &monitor->geometry) &&
+			           old_monitors[source].scale == monitor->scale) {
+				diff->changes[i] = LAYOUT_CHANGE_KEPT;
+				diff->kept++;
+			} else {
+				diff->changes[i] = LAYOUT_CHANGE_MOVED;
+				diff->moved++;
+			}
+		}
+
+		diff->sources[i] = source;
+		if (source >= 0)
+			diff->removed[source] = FALSE;
+	}
+
+	for (i = 0; i < old_monitors_size; ++i)
+		if (diff->removed[i])
+			diff->removed_count++;
+
+	return diff;
+}
+
+void
+layout_diff_free (LayoutDiff* diff)
+{
+	if (!diff)
+		return;
+
+	g_free (diff->changes);
+	g_free (diff->sources);
+	g_free (diff->removed);
+	g_free (diff);
+}
+
+void
+layout_debounce_init (LayoutDebounce*    debounce,
+                      guint              delay,
+                      LayoutDebounceFunc func,
+                      gpointer           user_data)
+{
+	debounce->delay = delay;
+	debounce->source_id = 0;
+	debounce->events = 0;
+	debounce->func = func;
+	debounce->user_data = user_data;
+}
+
+static gboolean
+layout_debounce_timeout_cb (gpointer data)
+{
+	LayoutDebounce* debounce = data;
+	guint events = debounce->events;
+
+	debounce->source_id = 0;
+	debounce->events = 0;
+	debounce->func (events, debounce->user_data);
+
+	return G_SOURCE_REMOVE;
+}
+
+void
+layout_debounce_event (LayoutDebounce* debounce)
+{
+	debounce->events++;
+
+	if (debounce->source_id)
+		g_source_remove (debounce->source_id);
+	debounce->source_id = g_timeout_add (debounce->delay, layout_debounce_timeout_cb, debounce);
+}
+
+void
+layout_debounce_cancel (LayoutDebounce* debounce)
+{
+	if (debounce->source_id)
+		g_source_remove (debounce->source_id);
+	debounce->source_id = 0;
+	debounce->events = 0;
+}
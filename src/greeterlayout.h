@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2015 - 2021 Gooroom <gooroom@gooroom.kr>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version. See http://www.gnu.org/copyleft/gpl.html the full text of the
+ * license.
+ */
+
+
+#ifndef GREETER_LAYOUT_H
+#define GREETER_LAYOUT_H
+
+#include <glib.h>
+#include <cairo.h>
+
+G_BEGIN_DECLS
+
+/* Monitor of a screen layout, GdkRectangle is a cairo_rectangle_int_t */
+typedef struct
+{
+	/* Model, NULL when unknown */
+	const gchar*          name;
+	cairo_rectangle_int_t geometry;
+	gint                  scale;
+	/* Area covered by the monitors before it (mirrors), it gets no window */
+	gboolean              skipped;
+} LayoutMonitor;
+
+typedef enum
+{
+	LAYOUT_CHANGE_SKIPPED,
+	/* Window of an old monitor is kept as is */
+	LAYOUT_CHANGE_KEPT,
+	/* Window of an old monitor gets a new geometry or scale */
+	LAYOUT_CHANGE_MOVED,
+	LAYOUT_CHANGE_CREATED
+} LayoutChange;
+
+typedef struct
+{
+	/* For each new monitor: its change and the old monitor it takes over, or -1 */
+	LayoutChange* changes;
+	gint*         sources;
+	/* For each old monitor: its window is destroyed */
+	gboolean*     removed;
+	gint          kept;
+	gint          moved;
+	gint          created;
+	gint          removed_count;
+} LayoutDiff;
+
+/* Sets "skipped" of monitors fully covered by the monitors before them */
+void        layout_mark_skipped (LayoutMonitor*       monitors,
+                                 gsize                monitors_size);
+
+/* Old monitors are matched by name and geometry first, then by name only */
+LayoutDiff* layout_diff         (const LayoutMonitor* old_monitors,
+                                 gsize                old_monitors_size,
+                                 const LayoutMonitor* monitors,
+                                 gsize                monitors_size);
+void        layout_diff_free    (LayoutDiff*          diff);
+
+typedef void (*LayoutDebounceFunc) (guint    events,
+                                    gpointer user_data);
+
+/* Calls "func" once, "delay" ms after the last of a burst of events */
+typedef struct
+{
+	guint              delay;
+	guint              source_id;
+	guint              events;
+	LayoutDebounceFunc func;
+	gpointer           user_data;
+} LayoutDebounce;
+
+void        layout_debounce_init   (LayoutDebounce*    debounce,
+                                    guint              delay,
+                                    LayoutDebounceFunc func,
+                                    gpointer           user_data);
+void        layout_debounce_event  (LayoutDebounce*    debounce);
+/* Drops pending events without calling "func" */
+void        layout_debounce_cancel (LayoutDebounce*    debounce);
+
+G_END_DECLS
+
+#endif
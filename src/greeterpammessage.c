@@ -0,0 +1,511 @@
+/*
+ * Copyright (C) 2015 - 2021 Gooroom <gooroom@gooroom.kr>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version. See http://www.gnu.org/copyleft/gpl.html the full text of the
+ * license.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include <glib/gi18n.h>
+
+#include "greeterpammessage.h"
+
+typedef struct
+{
+	const gchar*     tag;
+	/* Gettext domain of "tag", NULL to match it as is */
+	const gchar*     tag_domain;
+	gboolean         contains;
+	PamMessageAction action;
+	gboolean         post_login;
+	guint            fields;
+	guint            count_field;
+	const gchar*     text;
+	const gchar*     text_one;
+	const gchar*     text_zero;
+	const gchar*     fallback;
+	const gchar*     labels[PAM_MESSAGE_MAX_FIELDS + 1];
+	const gchar*     yes;
+	const gchar*     no;
+	const gchar*     response;
+} BuiltinRule;
+
+static const BuiltinRule BUILTIN_RULES[] =
+{
+	/* Linux-PAM, also in the languages it is translated to */
+	{ .tag = "You are required to change your password immediately",
+	  .contains = TRUE, .action = PAM_MESSAGE_ACTION_CHANGE_PASSWORD, .post_login = TRUE,
+	  .text = N_("Your password has expired.\n"
+	             "Please change your password immediately."),
+	  .yes = N_("Changing Password"), .no = N_("Cancel"), .response = "req_no_response" },
+	{ .tag = "You are required to change your password immediately (administrator enforced)",
+	  .tag_domain = "Linux-PAM",
+	  .contains = TRUE, .action = PAM_MESSAGE_ACTION_CHANGE_PASSWORD, .post_login = TRUE,
+	  .text = N_("Your password has expired.\n"
+	             "Please change your password immediately."),
+	  .yes = N_("Changing Password"), .no = N_("Cancel"), .response = "req_no_response" },
+	{ .tag = "You are required to change your password immediately (password expired)",
+	  .tag_domain = "Linux-PAM",
+	  .contains = TRUE, .action = PAM_MESSAGE_ACTION_CHANGE_PASSWORD, .post_login = TRUE,
+	  .text = N_("Your password has expired.\n"
+	             "Please change your password immediately."),
+	  .yes = N_("Changing Password"), .no = N_("Cancel"), .response = "req_no_response" },
+	{ .tag = N_("your password will expire in"), .tag_domain = GETTEXT_PACKAGE,
+	  .contains = TRUE, .action = PAM_MESSAGE_ACTION_WARNING },
+
+	/* pam-gooroom */
+	{ .tag = "Temporary Password",
+	  .action = PAM_MESSAGE_ACTION_CHANGE_PASSWORD, .post_login = TRUE,
+	  .text = N_("Your password has been issued temporarily.\n"
+	             "For security reasons, please change your password immediately."),
+	  .yes = N_("Changing Password"), .no = N_("Cancel"), .response = "req_no_response" },
+	{ .tag = "Password Maxday Warning",
+	  .action = PAM_MESSAGE_ACTION_CHANGE_PASSWORD, .post_login = TRUE, .fields = 1, .count_field = 1,
+	  .text = N_("Please change your password for security.\n"
+	             "If you do not change your password within %s days, "
+	             "your password expires.\n"
+	             "You can no longer log in.\n"
+	             "Do you want to change password now?"),
+	  .text_one = N_("Please change your password for security.\n"
+	                 "If you do not change your password within %s day, "
+	                 "your password expires.\n"
+	                 "You can no longer log in.\n"
+	                 "Do you want to change password now?"),
+	  .fallback = N_("Please change your password for security.\n"
+	                 "If you do not change your password within a few days, "
+	                 "your password expires.\n"
+	                 "You can no longer log in.\n"
+	                 "Do you want to change password now?"),
+	  .yes = N_("Change now"), .no = N_("Later"), .response = "req_response" },
+	{ .tag = "Account Expiration Warning",
+	  .action = PAM_MESSAGE_ACTION_WARNING, .post_login = TRUE, .fields = 2, .count_field = 2,
+	  .text = N_("Your account will not be available after %s.\n"
+	             "Your account will expire in %s days."),
+	  .text_one = N_("Your account will not be available after %s.\n"
+	                 "Your account will expire in %s day."),
+	  .response = "ACCT_EXP_OK" },
+	{ .tag = "Division Expiration Warning",
+	  .action = PAM_MESSAGE_ACTION_WARNING, .post_login = TRUE, .fields = 2, .count_field = 2,
+	  .text = N_("Your organization will not be available after %s.\n"
+	             "Your organization will expire in %s days."),
+	  .text_one = N_("Your organization will not be available after %s.\n"
+	                 "Your organization will expire in %s day."),
+	  .response = "DEPT_EXP_OK" },
+	{ .tag = "Password Expiration Warning",
+	  .action = PAM_MESSAGE_ACTION_WARNING, .post_login = TRUE, .fields = 2, .count_field = 2,
+	  .text = N_("Your password will not be available after %s.\n"
+	             "Your password will expire in %s days."),
+	  .text_one = N_("Your password will not be available after %s.\n"
+	                 "Your password will expire in %s day."),
+	  .response = "PASS_EXP_OK" },
+	{ .tag = "Duplicate Login Notification",
+	  .action = PAM_MESSAGE_ACTION_WARNING, .post_login = TRUE,
+	  .text = N_("Duplicate logins detected with the same ID."),
+	  .labels = { N_("Client ID"), N_("Client Name"), N_("IP"), N_("Local IP"), NULL },
+	  .response = "DUPLICATE_LOGIN_OK" },
+	{ .tag = "Trial Period Warning",
+	  .action = PAM_MESSAGE_ACTION_WARNING, .post_login = TRUE, .fields = 2, .count_field = 2,
+	  .text = N_("The trial period is up to %s days.\n"
+	             "%s days left to expire."),
+	  .text_one = N_("The trial period is up to %s days.\n"
+	                 "%s day left to expire."),
+	  .text_zero = N_("The trial period is up to %s days.\n"
+	                  "The trial period expires today."),
+	  .fallback = N_("The trial period is unknown."),
+	  .response = "TRIAL_LOGIN_OK" },
+	{ .tag = "Authentication Failure",
+	  .action = PAM_MESSAGE_ACTION_ERROR, .post_login = TRUE, .fields = 1,
+	  .text = N_("Authentication Failure\n"
+	             "You have %s login attempts remaining.\n"
+	             "You can no longer log in when the maximum number of login "
+	             "attempts is exceeded."),
+	  .fallback = N_("The user could not be authenticated due to an unknown error.\n"
+	                 "Please contact the administrator.") },
+	{ .tag = "Deleted Account",
+	  .action = PAM_MESSAGE_ACTION_ERROR,
+	  .text = N_("This account has deleted and is no longer available.\n"
+	             "Please contact the administrator.") },
+	{ .tag = "Invalid Account",
+	  .action = PAM_MESSAGE_ACTION_ERROR,
+	  .text = N_("You attempted to log in from an unregistered device.\n"
+	             "Please contact the administrator.") },
+	{ .tag = "No Exist Account",
+	  .action = PAM_MESSAGE_ACTION_ERROR,
+	  .text = N_("Authentication Failure\n"
+	             "Please check the username and password and try again.") },
+	{ .tag = "Policy Violation Account",
+	  .action = PAM_MESSAGE_ACTION_ERROR,
+	  .text = N_("Login was denied because "
+	             "it violated the policy set by the GPMS.\n"
+	             "Please contact the administrator.") },
+	{ .tag = "Not Allowed IP",
+	  .action = PAM_MESSAGE_ACTION_ERROR,
+	  .text = N_("Login was denied because "
+	             "it violated the policy(Allowed IP) set by the GPMS.\n"
+	             "Please contact the administrator.") },
+	{ .tag = "Account Locking",
+	  .action = PAM_MESSAGE_ACTION_ERROR, .post_login = TRUE,
+	  .text = N_("Your account has been locked because\n"
+	             "you have exceeded the number of login attempts.\n"
+	             "Please try again in a moment.") },
+	{ .tag = "Account Expiration",
+	  .action = PAM_MESSAGE_ACTION_ERROR, .post_login = TRUE,
+	  .text = N_("This account has expired and is no longer available.\n"
+	             "Please contact the administrator.") },
+	{ .tag = "Password Expiration",
+	  .action = PAM_MESSAGE_ACTION_ERROR, .post_login = TRUE,
+	  .text = N_("The password for your account has expired.\n"
+	             "Please contact the administrator.") },
+	{ .tag = "Duplicate Login",
+	  .action = PAM_MESSAGE_ACTION_ERROR, .post_login = TRUE,
+	  .text = N_("You are already logged in.\n"
+	             "Log out of the other device and try again.\n"
+	             "If the problem persists, please contact your administrator.") },
+	{ .tag = "Division Expiration",
+	  .action = PAM_MESSAGE_ACTION_ERROR, .post_login = TRUE,
+	  .text = N_("Due to the expiration of your organization, "
+	             "this account is no longer available.\n"
+	             "Please contact the administrator.") },
+	{ .tag = "Login Trial Exceed",
+	  .action = PAM_MESSAGE_ACTION_ERROR, .post_login = TRUE,
+	  .text = N_("Login attempts exceeded the number of times,\n"
+	             "so you cannot login for a certain period of time.\n"
+	             "Please try again in a moment.") },
+	{ .tag = "Trial Period Expired",
+	  .action = PAM_MESSAGE_ACTION_ERROR, .post_login = TRUE,
+	  .text = N_("Trial period has expired.") },
+	{ .tag = "DateTime Error",
+	  .action = PAM_MESSAGE_ACTION_ERROR, .post_login = TRUE,
+	  .text = N_("Time error occurred.") }
+};
+
+/* Tag -> PamMessageRule* */
+static GHashTable* tag_rules = NULL;
+/* PamMessageRule*, searched in order when no tag matches */
+static GPtrArray* contains_rules = NULL;
+
+
+static void
+rule_free (PamMessageRule* rule)
+{
+	g_free (rule->tag);
+	g_free (rule->text);
+	g_free (rule->text_one);
+	g_free (rule->text_zero);
+	g_free (rule->fallback);
+	g_strfreev (rule->labels);
+	g_free (rule->yes);
+	g_free (rule->no);
+	g_free (rule->response);
+	g_free (rule);
+}
+
+/* Only %s and %%, at most PAM_MESSAGE_MAX_FIELDS of them */
+static gboolean
+format_is_valid (const gchar* format)
+{
+	guint count = 0;
+	const gchar* p;
+
+	if (!format)
+		return TRUE;
+
+	for (p = strchr (format, '%'); p; p = strchr (p + 2, '%')) {
+		if (p[1] == 's')
+			count++;
+		else if (p[1] != '%')
+			return FALSE;
+	}
+
+	return count <= PAM_MESSAGE_MAX_FIELDS;
+}
+
+static gchar*
+translate (const gchar* text)
+{
+	return text ? g_strdup (_(text)) : NULL;
+}
+
+/* A broken translation falls back to the original text */
+static gchar*
+translate_format (const gchar* format)
+{
+	const gchar* translated;
+
+	if (!format)
+		return NULL;
+
+	translated = _(format);
+	return g_strdup (format_is_valid (translated) ? translated : format);
+}
+
+static PamMessageRule*
+rule_new_builtin (const BuiltinRule* builtin)
+{
+	guint i;
+	PamMessageRule* rule = g_new0 (PamMessageRule, 1);
+
+	rule->tag = g_strdup (builtin->tag_domain ? g_dgettext (builtin->tag_domain, builtin->tag) : builtin->tag);
+	rule->contains = builtin->contains;
+	rule->action = builtin->action;
+	rule->post_login = builtin->post_login;
+	rule->fields = builtin->fields;
+	rule->count_field = builtin->count_field;
+	rule->text = translate_format (builtin->text);
+	rule->text_one = translate_format (builtin->text_one);
+	rule->text_zero = translate_format (builtin->text_zero);
+	rule->fallback = translate (builtin->fallback);
+	rule->yes = translate (builtin->yes);
+	rule->no = translate (builtin->no);
+	rule->response = g_strdup (builtin->response);
+
+	if (builtin->labels[0]) {
+		rule->labels = g_new0 (gchar*, PAM_MESSAGE_MAX_FIELDS + 1);
+		for (i = 0; builtin->labels[i]; ++i)
+			rule->labels[i] = translate (builtin->labels[i]);
+	}
+
+	return rule;
+}
+
+static void
+rules_remove (const gchar* tag)
+{
+	guint i;
+
+	g_hash_table_remove (tag_rules, tag);
+
+	for (i = 0; i < contains_rules->len; ++i) {
+		PamMessageRule* rule = g_ptr_array_index (contains_rules, i);
+
+		if (g_strcmp0 (rule->tag, tag) == 0) {
+			g_ptr_array_remove_index (contains_rules, i);
+			break;
+		}
+	}
+}
+
+/* Replaces the rule of the same tag, contains rules keep their place */
+static void
+rules_add (PamMessageRule* rule)
+{
+	guint i;
+
+	if (!rule->contains) {
+		g_hash_table_replace (tag_rules, rule->tag, rule);
+		return;
+	}
+
+	for (i = 0; i < contains_rules->len; ++i) {
+		PamMessageRule* other = g_ptr_array_index (contains_rules, i);
+
+		if (g_strcmp0 (other->tag, rule->tag) == 0) {
+			rule_free (other);
+			g_ptr_array_index (contains_rules, i) = rule;
+			return;
+		}
+	}
+
+	g_ptr_array_add (contains_rules, rule);
+}
+
+static gboolean
+get_bool (GKeyFile* file, const gchar* group, const gchar* key, gboolean fallback)
+{
+	GError* error = NULL;
+	gboolean value = g_key_file_get_boolean (file, group, key, &error);
+
+	if (error) {
+		g_clear_error (&error);
+		return fallback;
+	}
+
+	return value;
+}
+
+static PamMessageRule*
+rule_new_from_file (GKeyFile* file, const gchar* group)
+{
+	gchar* action;
+	PamMessageRule* rule = g_new0 (PamMessageRule, 1);
+
+	rule->tag = g_strdup (group);
+	rule->contains = get_bool (file, group, "contains", FALSE);
+	rule->post_login = get_bool (file, group, "post-login", TRUE);
+	rule->fields = CLAMP (g_key_file_get_integer (file, group, "fields", NULL), 0, PAM_MESSAGE_MAX_FIELDS);
+	rule->count_field = CLAMP (g_key_file_get_integer (file, group, "count-field", NULL), 0, PAM_MESSAGE_MAX_FIELDS);
+	rule->text = g_key_file_get_locale_string (file, group, "text", NULL, NULL);
+	rule->text_one = g_key_file_get_locale_string (file, group, "text-one", NULL, NULL);
+	rule->text_zero = g_key_file_get_locale_string (file, group, "text-zero", NULL, NULL);
+	rule->fallback = g_key_file_get_locale_string (file, group, "fallback", NULL, NULL);
+	rule->labels = g_key_file_get_locale_string_list (file, group, "labels", NULL, NULL, NULL);
+	rule->yes = g_key_file_get_locale_string (file, group, "yes", NULL, NULL);
+	rule->no = g_key_file_get_locale_string (file, group, "no", NULL, NULL);
+	rule->response = g_key_file_get_string (file, group, "response", NULL);
+
+	action = g_key_file_get_string (file, group, "action", NULL);
+	if (g_strcmp0 (action, "change-password") == 0)
+		rule->action = PAM_MESSAGE_ACTION_CHANGE_PASSWORD;
+	else if (g_strcmp0 (action, "warning") == 0)
+		rule->action = PAM_MESSAGE_ACTION_WARNING;
+	else if (g_strcmp0 (action, "error") == 0)
+		rule->action = PAM_MESSAGE_ACTION_ERROR;
+	else {
+		g_warning ("[PAM] Invalid action of [%s]: %s", group, action ? action : "(none)");
+		g_clear_pointer (&rule, rule_free);
+	}
+	g_free (action);
+
+	if (rule && (!format_is_valid (rule->text) || !format_is_valid (rule->text_one) ||
+	             !format_is_valid (rule->text_zero))) {
+		g_warning ("[PAM] Texts of [%s] may only use up to %d %%s", group, PAM_MESSAGE_MAX_FIELDS);
+		g_clear_pointer (&rule, rule_free);
+	}
+
+	return rule;
+}
+
+static void
+rules_load (const gchar* path)
+{
+	gchar** groups;
+	gchar** group;
+	GError* error = NULL;
+	GKeyFile* file = g_key_file_new ();
+
+	if (!g_key_file_load_from_file (file, path, G_KEY_FILE_NONE, &error)) {
+		g_warning ("[PAM] Failed to read message rules '%s': %s", path, error->message);
+		g_clear_error (&error);
+		g_key_file_unref (file);
+		return;
+	}
+
+	g_message ("[PAM] Reading message rules: %s", path);
+
+	groups = g_key_file_get_groups (file, NULL);
+	for (group = groups; *group; ++group) {
+		PamMessageRule* rule;
+
+		/* [-TAG] drops a built-in rule, like groups of the configuration */
+		if (**group == '-') {
+			rules_remove (*group + 1);
+			continue;
+		}
+
+		rule = rule_new_from_file (file, *group);
+		if (rule)
+			rules_add (rule);
+	}
+	g_strfreev (groups);
+
+	g_key_file_unref (file);
+}
+
+void
+pam_message_rules_init (const gchar* path)
+{
+	guint i;
+
+	pam_message_rules_clear ();
+
+	tag_rules = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) rule_free);
+	contains_rules = g_ptr_array_new_with_free_func ((GDestroyNotify) rule_free);
+
+	/* Translations are looked up here once, not for every message */
+	for (i = 0; i < G_N_ELEMENTS (BUILTIN_RULES); ++i)
+		rules_add (rule_new_builtin (&BUILTIN_RULES[i]));
+
+	if (path && *path)
+		rules_load (path);
+}
+
+void
+pam_message_rules_clear (void)
+{
+	g_clear_pointer (&tag_rules, g_hash_table_unref);
+	g_clear_pointer (&contains_rules, g_ptr_array_unref);
+}
+
+const PamMessageRule*
+pam_message_classify (const gchar*  text,
+                      gchar***      fields)
+{
+	guint i;
+	const gchar* colon;
+	PamMessageRule* rule;
+
+	if (fields)
+		*fields = NULL;
+
+	if (!text || !tag_rules)
+		return NULL;
+
+	colon = strchr (text, ':');
+	if (colon) {
+		gchar* tag = g_strndup (text, colon - text);
+		rule = g_hash_table_lookup (tag_rules, tag);
+		g_free (tag);
+	} else {
+		rule = g_hash_table_lookup (tag_rules, text);
+	}
+
+	/* Free-form texts, e.g. of Linux-PAM */
+	for (i = 0; !rule && i < contains_rules->len; ++i) {
+		PamMessageRule* other = g_ptr_array_index (contains_rules, i);
+
+		if (strstr (text, other->tag))
+			rule = other;
+	}
+
+	if (rule && fields)
+		*fields = g_strsplit (text, ":", -1);
+
+	return rule;
+}
+
+gchar*
+pam_message_format (const PamMessageRule* rule,
+                    const gchar*  text,
+                    gchar**       fields)
+{
+	guint i;
+	GString* message;
+	const gchar* args[PAM_MESSAGE_MAX_FIELDS];
+	const gchar* format = rule->text;
+	guint count = fields ? g_strv_length (fields) : 0;
+
+	if (!format)
+		return g_strdup (text);
+
+	/* Fields follow the tag */
+	if (rule->fields > 0 && count <= rule->fields)
+		return g_strdup (rule->fallback ? rule->fallback : text);
+
+	if (rule->count_field > 0 && rule->count_field < count) {
+		const gchar* value = fields[rule->count_field];
+
+		if (rule->text_zero && g_str_equal (value, "0"))
+			format = rule->text_zero;
+		else if (rule->text_one && g_str_equal (value, "1"))
+			format = rule->text_one;
+	}
+
+	for (i = 0; i < PAM_MESSAGE_MAX_FIELDS; ++i)
+		args[i] = i + 1 < count ? fields[i + 1] : "";
+
+	message = g_string_new (NULL);
+	g_string_printf (message, format, args[0], args[1], args[2], args[3]);
+
+	for (i = 0; rule->labels && rule->labels[i] && i + 1 < count; ++i)
+		g_string_append_printf (message, i == 0 ? "\n\n%s : %s" : "\n%s : %s",
+                                rule->labels[i], fields[i + 1]);
+
+	return g_string_free (message, FALSE);
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2015 - 2021 Gooroom <gooroom@gooroom.kr>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version. See http://www.gnu.org/copyleft/gpl.html the full text of the
+ * license.
+ */
+
+
+#ifndef GREETER_PAM_MESSAGE_H
+#define GREETER_PAM_MESSAGE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+	/* Ask to change the password now, with "yes" and "no" buttons */
+	PAM_MESSAGE_ACTION_CHANGE_PASSWORD,
+	/* Warn and go on, "response" is sent to PAM if set */
+	PAM_MESSAGE_ACTION_WARNING,
+	/* Login failed, the rest of the conversation is dropped */
+	PAM_MESSAGE_ACTION_ERROR
+} PamMessageAction;
+
+/* Most fields a message text can use */
+#define PAM_MESSAGE_MAX_FIELDS 4
+
+/* GPMS messages are "Tag:field:field...", texts are already translated */
+typedef struct
+{
+	/* Tag before the first ':', or a text searched in the whole message */
+	gchar*           tag;
+	gboolean         contains;
+	PamMessageAction action;
+	/* Hide the splash and unlock the entries first */
+	gboolean         post_login;
+	/* Fields the texts need, "fallback" is shown when there are fewer */
+	guint            fields;
+	/* Field choosing "text_zero" for 0 and "text_one" for 1, 0 for none */
+	guint            count_field;
+	/* One %s per field in order, NULL shows the message as is */
+	gchar*           text;
+	gchar*           text_one;
+	gchar*           text_zero;
+	gchar*           fallback;
+	/* Present fields are appended as "label : field" lines */
+	gchar**          labels;
+	gchar*           yes;
+	gchar*           no;
+	gchar*           response;
+} PamMessageRule;
+
+/* Built-in rules, then the [TAG] groups of "path" (may be NULL) added or replaced */
+void                  pam_message_rules_init  (const gchar*  path);
+void                  pam_message_rules_clear (void);
+
+/* NULL for messages without a rule, otherwise "fields" is the text split on ':' */
+const PamMessageRule* pam_message_classify    (const gchar*  text,
+                                               gchar***      fields);
+gchar*                pam_message_format      (const PamMessageRule* rule,
+                                               const gchar*  text,
+                                               gchar**       fields);
+
+G_END_DECLS
+
+#endif
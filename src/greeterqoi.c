@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2015 - 2021 Gooroom <gooroom@gooroom.kr>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version. See http://www.gnu.org/copyleft/gpl.html the full text of the
+ * license.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include "greeterqoi.h"
+
+#define QOI_MAGIC           "qoif"
+#define QOI_HEADER_SIZE     14
+#define QOI_END_MARKER_SIZE 8
+#define QOI_MAX_PIXELS      400000000
+
+#define QOI_OP_INDEX        0x00
+#define QOI_OP_DIFF         0x40
+#define QOI_OP_LUMA         0x80
+#define QOI_OP_RUN          0xc0
+#define QOI_OP_RGB          0xfe
+#define QOI_OP_RGBA         0xff
+#define QOI_MASK_2          0xc0
+
+#define QOI_HASH(px)        (((px)[0] * 3 + (px)[1] * 5 + (px)[2] * 7 + (px)[3] * 11) % 64)
+
+static const guchar qoi_end_marker[QOI_END_MARKER_SIZE] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+
+gboolean
+qoi_file_has_extension (const gchar* path)
+{
+	gsize length;
+
+	if (!path)
+		return FALSE;
+
+	length = strlen (path);
+	return length > 4 && g_ascii_strcasecmp (path + length - 4, ".qoi") == 0;
+}
+
+static guint32
+read_be32 (const guchar* p)
+{
+	return ((guint32) p[0] << 24) | ((guint32) p[1] << 16) | ((guint32) p[2] << 8) | p[3];
+}
+
+/* Decodes chunks into pixbuf rows, FALSE if the stream ends early.
+ * Data from "end" on must still be readable (the end marker). */
+static gboolean
+qoi_decode (const guchar* p,
+            const guchar* end,
+            GdkPixbuf*    pixbuf)
+{
+	gint x, y, run = 0;
+	guchar index[64][4];
+	guchar px[4] = {0, 0, 0, 255};
+	gint width = gdk_pixbuf_get_width (pixbuf);
+	gint height = gdk_pixbuf_get_height (pixbuf);
+	gint channels = gdk_pixbuf_get_n_channels (pixbuf);
+	gint rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+	guchar* pixels = gdk_pixbuf_get_pixels (pixbuf);
+
+	memset (index, 0, sizeof (index));
+
+	for (y = 0; y < height; ++y) {
+		guchar* dest = pixels + (gsize) y * rowstride;
+
+		for (x = 0; x < width; ++x, dest += channels) {
+			if (run > 0) {
+				run--;
+			} else {
+				guchar op;
+
+				/* Chunk payload is at most 4 bytes, so reading it never goes
+				 * past the 8 byte end marker that follows "end" */
+				if (p >= end)
+					return FALSE;
+
+				op = *p++;
+
+				if (op == QOI_OP_RGB) {
+					px[0] = *p++;
+					px[1] = *p++;
+					px[2] = *p++;
+				} else if (op == QOI_OP_RGBA) {
+					px[0] = *p++;
+					px[1] = *p++;
+					px[2] = *p++;
+					px[3] = *p++;
+				} else switch (op & QOI_MASK_2) {
+					case QOI_OP_INDEX:
+						memcpy (px, index[op], 4);
+						break;
+					case QOI_OP_DIFF:
+						px[0] += ((op >> 4) & 0x03) - 2;
+						px[1] += ((op >> 2) & 0x03) - 2;
+						px[2] += (op & 0x03) - 2;
+						break;
+					case QOI_OP_LUMA: {
+						guchar b = *p++;
+						gint vg = (op & 0x3f) - 32;
+						px[0] += vg - 8 + ((b >> 4) & 0x0f);
+						px[1] += vg;
+						px[2] += vg - 8 + (b & 0x0f);
+						break;
+					}
+					case QOI_OP_RUN:
+						run = op & 0x3f;
+						break;
+				}
+
+				memcpy (index[QOI_HASH (px)], px, 4);
+			}
+
+			dest[0] = px[0];
+			dest[1] = px[1];
+			dest[2] = px[2];
+			if (channels == 4)
+				dest[3] = px[3];
+		}
+	}
+
+	return TRUE;
+}
+
+GdkPixbuf*
+qoi_load_pixbuf (const gchar* path,
+                 GError**     error)
+{
+	gsize length;
+	guint32 width, height;
+	guchar channels;
+	const guchar* data;
+	GMappedFile* mapped;
+	GdkPixbuf* pixbuf;
+
+	mapped = g_mapped_file_new (path, FALSE, error);
+	if (!mapped)
+		return NULL;
+
+	data = (const guchar*) g_mapped_file_get_contents (mapped);
+	length = g_mapped_file_get_length (mapped);
+
+	if (length < QOI_HEADER_SIZE + QOI_END_MARKER_SIZE || memcmp (data, QOI_MAGIC, 4) != 0) {
+		g_set_error (error, GDK_PIXBUF_ERROR, GDK_PIXBUF_ERROR_UNKNOWN_TYPE,
+                     "Not a QOI image: %s", path);
+		g_mapped_file_unref (mapped);
+		return NULL;
+	}
+
+	width = read_be32 (data + 4);
+	height = read_be32 (data + 8);
+	channels = data[12];
+
+	if (width == 0 || height == 0 || width > G_MAXINT || height > G_MAXINT ||
+	    (guint64) width * height > QOI_MAX_PIXELS || (channels != 3 && channels != 4)) {
+		g_set_error (error, GDK_PIXBUF_ERROR, GDK_PIXBUF_ERROR_CORRUPT_IMAGE,
+                     "Invalid QOI header: %s", path);
+		g_mapped_file_unref (mapped);
+		return NULL;
+	}
+
+	pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, channels == 4, 8, width, height);
+	if (!pixbuf) {
+		g_set_error (error, GDK_PIXBUF_ERROR, GDK_PIXBUF_ERROR_INSUFFICIENT_MEMORY,
+                     "Not enough memory to load %ux%u QOI image: %s", width, height, path);
+		g_mapped_file_unref (mapped);
+		return NULL;
+	}
+
+	if (!qoi_decode (data + QOI_HEADER_SIZE, data + length - QOI_END_MARKER_SIZE, pixbuf) ||
+	    memcmp (data + length - QOI_END_MARKER_SIZE, qoi_end_marker, QOI_END_MARKER_SIZE) != 0) {
+		g_set_error (error, GDK_PIXBUF_ERROR, GDK_PIXBUF_ERROR_CORRUPT_IMAGE,
+                     "Truncated QOI image: %s", path);
+		g_clear_object (&pixbuf);
+	}
+
+	g_mapped_file_unref (mapped);
+
+	return pixbuf;
+}
@@ -0,0 +1,27 @@
+/*
+ * Copyright (C) 2015 - 2021 Gooroom <gooroom@gooroom.kr>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version. See http://www.gnu.org/copyleft/gpl.html the full text of the
+ * license.
+ */
+
+
+#ifndef GREETER_QOI_H
+#define GREETER_QOI_H
+
+#include <glib.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+G_BEGIN_DECLS
+
+/* Built-in decoder for "Quite OK Image" files, see https://qoiformat.org */
+gboolean   qoi_file_has_extension (const gchar* path);
+GdkPixbuf* qoi_load_pixbuf        (const gchar* path,
+                                   GError**     error);
+
+G_END_DECLS
+
+#endif
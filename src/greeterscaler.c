@@ -0,0 +1,511 @@
+/*
+ * Copyright (C) 2015 - 2021 Gooroom <gooroom@gooroom.kr>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version. See http://www.gnu.org/copyleft/gpl.html the full text of the
+ * license.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include "greeterscaler.h"
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define SCALER_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+/* Separable filter in fixed point: vertical pass keeps 6 fractional bits
+ * per sample in 16 bits, so both passes fit int16 x int16 -> int32 madd.
+ * Integer sums do not depend on the evaluation order, which is what makes
+ * SIMD kernels bit-exact with the scalar one. */
+#define WEIGHT_BITS         14
+#define WEIGHT_ONE          (1 << WEIGHT_BITS)
+#define TMP_SHIFT           8
+#define TMP_ROUND           (1 << (TMP_SHIFT - 1))
+#define OUT_SHIFT           (2 * WEIGHT_BITS - TMP_SHIFT)
+#define OUT_ROUND           (1 << (OUT_SHIFT - 1))
+
+/* Horizontal kernels read one sample past the last pixel of 3 channel rows */
+#define TMP_PADDING         4
+
+/* Do not start a thread for fewer output rows */
+#define MIN_BAND_ROWS       32
+
+/* Source taps for each output pixel of one axis */
+typedef struct
+{
+	gint* start;
+	gint* count;
+	gint16* weights;
+	gint max_taps;
+} ScalerContrib;
+
+typedef void (*ScalerVerticalFunc)   (const guchar* const* rows,
+                                      const gint16*        weights,
+                                      gint                 taps,
+                                      gint16*              dest,
+                                      gint                 length);
+typedef void (*ScalerHorizontalFunc) (const gint16*        src,
+                                      const ScalerContrib* contrib,
+                                      gint                 channels,
+                                      guchar*              dest,
+                                      gint                 width);
+
+typedef struct
+{
+	const guchar* src_pixels;
+	gint src_rowstride;
+	gint src_width;
+	gint channels;
+	guchar* dest_pixels;
+	gint dest_rowstride;
+	gint dest_width;
+	ScalerContrib x_contrib;
+	ScalerContrib y_contrib;
+	ScalerVerticalFunc vertical;
+	ScalerHorizontalFunc horizontal;
+} ScalerJob;
+
+typedef struct
+{
+	const ScalerJob* job;
+	gint first_row;
+	gint last_row;
+} ScalerBand;
+
+/* Threads scaling right now, callers included. Bands only get extra threads
+ * while this is below the number of cores, so scaling from every thread of
+ * a pool does not start a band thread per core in each of them. */
+static gint scaler_busy_threads = 0;
+G_LOCK_DEFINE_STATIC (scaler_threads);
+
+static const gchar* SCALER_FILTER_NAMES[] = {
+	"bilinear", "area", NULL };
+
+static const gchar* SCALER_KERNEL_NAMES[] = {
+	"auto", "scalar", "sse2", "avx2", NULL };
+
+
+gboolean
+scaler_filter_from_string (const gchar* name, ScalerFilter* filter)
+{
+	gint i;
+
+	for (i = 0; SCALER_FILTER_NAMES[i]; ++i) {
+		if (g_strcmp0 (name, SCALER_FILTER_NAMES[i]) == 0) {
+			*filter = (ScalerFilter) i;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+const gchar*
+scaler_kernel_to_string (ScalerKernel kernel)
+{
+	g_return_val_if_fail (kernel <= SCALER_KERNEL_AVX2, NULL);
+
+	return SCALER_KERNEL_NAMES[kernel];
+}
+
+static void
+scaler_contrib_init (ScalerContrib* contrib, gint src_size, gint dst_size)
+{
+	gint i;
+	gdouble* w;
+	gdouble ratio = (gdouble) src_size / dst_size;
+
+	contrib->max_taps = ratio > 1.0 ? (gint) ceil (ratio) + 1 : 2;
+	contrib->start = g_new (gint, dst_size);
+	contrib->count = g_new (gint, dst_size);
+	contrib->weights = g_new0 (gint16, (gsize) dst_size * contrib->max_taps);
+
+	w = g_new (gdouble, contrib->max_taps);
+
+	for (i = 0; i < dst_size; ++i) {
+		gint j, first, last, sum = 0, largest = 0;
+		gint16* q = contrib->weights + (gsize) i * contrib->max_taps;
+
+		if (ratio > 1.0) {
+			/* Output pixel covers [left, right) of the source */
+			gdouble left = i * ratio;
+			gdouble right = MIN ((i + 1) * ratio, src_size);
+
+			first = floor (left);
+			last = MIN ((gint) ceil (right), src_size) - 1;
+			for (j = first; j <= last; ++j)
+				w[j - first] = (MIN (j + 1, right) - MAX (j, left)) / ratio;
+		} else {
+			gdouble center = (i + 0.5) * ratio - 0.5;
+			gdouble f;
+
+			j = floor (center);
+			f = center - j;
+			first = CLAMP (j, 0, src_size - 1);
+			last = CLAMP (j + 1, 0, src_size - 1);
+			if (first == last) {
+				w[0] = 1.0;
+			} else {
+				w[0] = 1.0 - f;
+				w[1] = f;
+			}
+		}
+
+		/* Quantized weights must sum to exactly WEIGHT_ONE */
+		for (j = 0; j <= last - first; ++j) {
+			q[j] = (gint16) floor (w[j] * WEIGHT_ONE + 0.5);
+			sum += q[j];
+			if (q[j] > q[largest])
+				largest = j;
+		}
+		q[largest] += WEIGHT_ONE - sum;
+
+		contrib->start[i] = first;
+		contrib->count[i] = last - first + 1;
+	}
+
+	g_free (w);
+}
+
+static void
+scaler_contrib_clear (ScalerContrib* contrib)
+{
+	g_clear_pointer (&contrib->start, g_free);
+	g_clear_pointer (&contrib->count, g_free);
+	g_clear_pointer (&contrib->weights, g_free);
+}
+
+static void
+scaler_vertical_range (const guchar* const* rows,
+                       const gint16*        weights,
+                       gint                 taps,
+                       gint16*              dest,
+                       gint                 start,
+                       gint                 length)
+{
+	gint x, k;
+
+	for (x = start; x < length; ++x) {
+		gint32 acc = TMP_ROUND;
+		for (k = 0; k < taps; ++k)
+			acc += weights[k] * rows[k][x];
+		dest[x] = acc >> TMP_SHIFT;
+	}
+}
+
+static void
+scaler_vertical_scalar (const guchar* const* rows,
+                        const gint16*        weights,
+                        gint                 taps,
+                        gint16*              dest,
+                        gint                 length)
+{
+	scaler_vertical_range (rows, weights, taps, dest, 0, length);
+}
+
+static void
+scaler_horizontal_scalar (const gint16*        src,
+                          const ScalerContrib* contrib,
+                          gint                 channels,
+                          guchar*              dest,
+                          gint                 width)
+{
+	gint i, c, k;
+
+	for (i = 0; i < width; ++i) {
+		const gint16* weights = contrib->weights + (gsize) i * contrib->max_taps;
+		const gint16* p = src + contrib->start[i] * channels;
+
+		for (c = 0; c < channels; ++c) {
+			gint32 acc = OUT_ROUND;
+			for (k = 0; k < contrib->count[i]; ++k)
+				acc += weights[k] * p[k * channels + c];
+			dest[i * channels + c] = CLAMP (acc >> OUT_SHIFT, 0, 255);
+		}
+	}
+}
+
+#ifdef SCALER_HAVE_X86
+/* Taps are processed in pairs: samples of two taps are interleaved and
+ * multiplied by (w0, w1) with madd. Odd tap is paired with itself and 0. */
+static inline guint32
+weight_pair (const gint16* weights, gint k, gint taps)
+{
+	return (guint16) weights[k] | (k + 1 < taps ? (guint32) (guint16) weights[k + 1] << 16 : 0);
+}
+
+__attribute__ ((target ("sse2")))
+static void
+scaler_vertical_sse2 (const guchar* const* rows,
+                      const gint16*        weights,
+                      gint                 taps,
+                      gint16*              dest,
+                      gint                 length)
+{
+	gint x, k;
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i round = _mm_set1_epi32 (TMP_ROUND);
+
+	for (x = 0; x + 16 <= length; x += 16) {
+		__m128i acc0 = round, acc1 = round, acc2 = round, acc3 = round;
+
+		for (k = 0; k < taps; k += 2) {
+			const guchar* row_b = k + 1 < taps ? rows[k + 1] : rows[k];
+			__m128i w = _mm_set1_epi32 (weight_pair (weights, k, taps));
+			__m128i a = _mm_loadu_si128 ((const __m128i*) (rows[k] + x));
+			__m128i b = _mm_loadu_si128 ((const __m128i*) (row_b + x));
+			__m128i a_lo = _mm_unpacklo_epi8 (a, zero);
+			__m128i a_hi = _mm_unpackhi_epi8 (a, zero);
+			__m128i b_lo = _mm_unpacklo_epi8 (b, zero);
+			__m128i b_hi = _mm_unpackhi_epi8 (b, zero);
+
+			acc0 = _mm_add_epi32 (acc0, _mm_madd_epi16 (_mm_unpacklo_epi16 (a_lo, b_lo), w));
+			acc1 = _mm_add_epi32 (acc1, _mm_madd_epi16 (_mm_unpackhi_epi16 (a_lo, b_lo), w));
+			acc2 = _mm_add_epi32 (acc2, _mm_madd_epi16 (_mm_unpacklo_epi16 (a_hi, b_hi), w));
+			acc3 = _mm_add_epi32 (acc3, _mm_madd_epi16 (_mm_unpackhi_epi16 (a_hi, b_hi), w));
+		}
+
+		acc0 = _mm_srai_epi32 (acc0, TMP_SHIFT);
+		acc1 = _mm_srai_epi32 (acc1, TMP_SHIFT);
+		acc2 = _mm_srai_epi32 (acc2, TMP_SHIFT);
+		acc3 = _mm_srai_epi32 (acc3, TMP_SHIFT);
+		_mm_storeu_si128 ((__m128i*) (dest + x), _mm_packs_epi32 (acc0, acc1));
+		_mm_storeu_si128 ((__m128i*) (dest + x + 8), _mm_packs_epi32 (acc2, acc3));
+	}
+
+	scaler_vertical_range (rows, weights, taps, dest, x, length);
+}
+
+__attribute__ ((target ("sse2")))
+static void
+scaler_horizontal_sse2 (const gint16*        src,
+                        const ScalerContrib* contrib,
+                        gint                 channels,
+                        guchar*              dest,
+                        gint                 width)
+{
+	gint i, k;
+	const __m128i round = _mm_set1_epi32 (OUT_ROUND);
+
+	for (i = 0; i < width; ++i) {
+		const gint16* weights = contrib->weights + (gsize) i * contrib->max_taps;
+		const gint16* p = src + contrib->start[i] * channels;
+		gint taps = contrib->count[i];
+		__m128i acc = round;
+		guint32 pixel;
+
+		for (k = 0; k < taps; k += 2) {
+			const gint16* p_b = k + 1 < taps ? p + (k + 1) * channels : p + k * channels;
+			__m128i w = _mm_set1_epi32 (weight_pair (weights, k, taps));
+			__m128i a = _mm_loadl_epi64 ((const __m128i*) (p + k * channels));
+			__m128i b = _mm_loadl_epi64 ((const __m128i*) p_b);
+
+			acc = _mm_add_epi32 (acc, _mm_madd_epi16 (_mm_unpacklo_epi16 (a, b), w));
+		}
+
+		acc = _mm_packs_epi32 (_mm_srai_epi32 (acc, OUT_SHIFT), acc);
+		pixel = _mm_cvtsi128_si32 (_mm_packus_epi16 (acc, acc));
+		memcpy (dest + i * channels, &pixel, channels);
+	}
+}
+
+__attribute__ ((target ("avx2")))
+static void
+scaler_vertical_avx2 (const guchar* const* rows,
+                      const gint16*        weights,
+                      gint                 taps,
+                      gint16*              dest,
+                      gint                 length)
+{
+	gint x, k;
+	const __m256i round = _mm256_set1_epi32 (TMP_ROUND);
+
+	/* unpack and packs work within 128 bit lanes, so the lane shuffle
+	 * of unpacklo/unpackhi is undone by packs and rows stay in order */
+	for (x = 0; x + 16 <= length; x += 16) {
+		__m256i acc0 = round, acc1 = round;
+
+		for (k = 0; k < taps; k += 2) {
+			const guchar* row_b = k + 1 < taps ? rows[k + 1] : rows[k];
+			__m256i w = _mm256_set1_epi32 (weight_pair (weights, k, taps));
+			__m256i a = _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i*) (rows[k] + x)));
+			__m256i b = _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i*) (row_b + x)));
+
+			acc0 = _mm256_add_epi32 (acc0, _mm256_madd_epi16 (_mm256_unpacklo_epi16 (a, b), w));
+			acc1 = _mm256_add_epi32 (acc1, _mm256_madd_epi16 (_mm256_unpackhi_epi16 (a, b), w));
+		}
+
+		acc0 = _mm256_srai_epi32 (acc0, TMP_SHIFT);
+		acc1 = _mm256_srai_epi32 (acc1, TMP_SHIFT);
+		_mm256_storeu_si256 ((__m256i*) (dest + x), _mm256_packs_epi32 (acc0, acc1));
+	}
+
+	scaler_vertical_range (rows, weights, taps, dest, x, length);
+}
+#endif
+
+ScalerKernel
+scaler_detect_kernel (void)
+{
+	static gsize detected = 0;
+
+	if (g_once_init_enter (&detected)) {
+		ScalerKernel kernel = SCALER_KERNEL_SCALAR;
+#ifdef SCALER_HAVE_X86
+		__builtin_cpu_init ();
+		if (__builtin_cpu_supports ("avx2"))
+			kernel = SCALER_KERNEL_AVX2;
+		else if (__builtin_cpu_supports ("sse2"))
+			kernel = SCALER_KERNEL_SSE2;
+#endif
+		g_once_init_leave (&detected, kernel + 1);
+	}
+
+	return (ScalerKernel) (detected - 1);
+}
+
+/* Takes the calling thread and up to "wanted" extra threads, returns the extra ones */
+static gint
+scaler_threads_acquire (gint wanted)
+{
+	gint extra;
+
+	G_LOCK (scaler_threads);
+	++scaler_busy_threads;
+	extra = CLAMP ((gint) g_get_num_processors () - scaler_busy_threads, 0, wanted);
+	scaler_busy_threads += extra;
+	G_UNLOCK (scaler_threads);
+
+	return extra;
+}
+
+static void
+scaler_threads_release (gint extra)
+{
+	G_LOCK (scaler_threads);
+	scaler_busy_threads -= extra + 1;
+	G_UNLOCK (scaler_threads);
+}
+
+static gpointer
+scaler_band_run (gpointer data)
+{
+	gint y, k;
+	ScalerBand* band = data;
+	const ScalerJob* job = band->job;
+	gint length = job->src_width * job->channels;
+	gint16* tmp = g_new0 (gint16, length + TMP_PADDING);
+	const guchar** rows = g_new (const guchar*, job->y_contrib.max_taps);
+
+	for (y = band->first_row; y < band->last_row; ++y) {
+		gint taps = job->y_contrib.count[y];
+
+		for (k = 0; k < taps; ++k)
+			rows[k] = job->src_pixels + (gsize) (job->y_contrib.start[y] + k) * job->src_rowstride;
+
+		job->vertical (rows, job->y_contrib.weights + (gsize) y * job->y_contrib.max_taps,
+                       taps, tmp, length);
+		job->horizontal (tmp, &job->x_contrib, job->channels,
+                         job->dest_pixels + (gsize) y * job->dest_rowstride, job->dest_width);
+	}
+
+	g_free (rows);
+	g_free (tmp);
+
+	return NULL;
+}
+
+GdkPixbuf*
+scaler_scale_pixbuf (GdkPixbuf*   source,
+                     gint         width,
+                     gint         height,
+                     ScalerFilter filter,
+                     ScalerKernel kernel)
+{
+	gint i, channels, n_bands;
+	ScalerJob job;
+	ScalerBand* bands;
+	GThread** threads;
+	GdkPixbuf* dest;
+
+	g_return_val_if_fail (GDK_IS_PIXBUF (source), NULL);
+	g_return_val_if_fail (width > 0 && height > 0, NULL);
+
+	channels = gdk_pixbuf_get_n_channels (source);
+
+	if (filter == SCALER_FILTER_BILINEAR ||
+	    gdk_pixbuf_get_bits_per_sample (source) != 8 ||
+	    (channels != 3 && channels != 4))
+		return gdk_pixbuf_scale_simple (source, width, height, GDK_INTERP_BILINEAR);
+
+	dest = gdk_pixbuf_new (GDK_COLORSPACE_RGB, gdk_pixbuf_get_has_alpha (source), 8, width, height);
+	if (!dest)
+		return NULL;
+
+	if (kernel == SCALER_KERNEL_AUTO || kernel > scaler_detect_kernel ())
+		kernel = scaler_detect_kernel ();
+
+	job.src_pixels = gdk_pixbuf_get_pixels (source);
+	job.src_rowstride = gdk_pixbuf_get_rowstride (source);
+	job.src_width = gdk_pixbuf_get_width (source);
+	job.channels = channels;
+	job.dest_pixels = gdk_pixbuf_get_pixels (dest);
+	job.dest_rowstride = gdk_pixbuf_get_rowstride (dest);
+	job.dest_width = width;
+	job.vertical = scaler_vertical_scalar;
+	job.horizontal = scaler_horizontal_scalar;
+
+#ifdef SCALER_HAVE_X86
+	if (kernel >= SCALER_KERNEL_SSE2) {
+		job.vertical = kernel == SCALER_KERNEL_AVX2 ? scaler_vertical_avx2 : scaler_vertical_sse2;
+		job.horizontal = scaler_horizontal_sse2;
+	}
+#endif
+
+	scaler_contrib_init (&job.x_contrib, job.src_width, width);
+	scaler_contrib_init (&job.y_contrib, gdk_pixbuf_get_height (source), height);
+
+	/* Output rows are independent, split them into bands across the idle cores */
+	n_bands = 1 + scaler_threads_acquire (CLAMP (height / MIN_BAND_ROWS, 1, (gint) g_get_num_processors ()) - 1);
+	bands = g_new (ScalerBand, n_bands);
+	threads = g_new0 (GThread*, n_bands);
+
+	g_debug ("[Background] Scaling %dx%d to %dx%d: %s filter, %s kernel, %d threads",
+             job.src_width, gdk_pixbuf_get_height (source), width, height,
+             SCALER_FILTER_NAMES[filter], scaler_kernel_to_string (kernel), n_bands);
+
+	for (i = 0; i < n_bands; ++i) {
+		bands[i].job = &job;
+		bands[i].first_row = (gint64) height * i / n_bands;
+		bands[i].last_row = (gint64) height * (i + 1) / n_bands;
+		if (i > 0)
+			threads[i] = g_thread_try_new ("scaler", scaler_band_run, &bands[i], NULL);
+	}
+
+	scaler_band_run (&bands[0]);
+
+	for (i = 1; i < n_bands; ++i) {
+		if (threads[i])
+			g_thread_join (threads[i]);
+		else
+			scaler_band_run (&bands[i]);
+	}
+
+	scaler_threads_release (n_bands - 1);
+
+	g_free (threads);
+	g_free (bands);
+	scaler_contrib_clear (&job.x_contrib);
+	scaler_contrib_clear (&job.y_contrib);
+
+	return dest;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2015 - 2021 Gooroom <gooroom@gooroom.kr>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version. See http://www.gnu.org/copyleft/gpl.html the full text of the
+ * license.
+ */
+
+
+#ifndef GREETER_SCALER_H
+#define GREETER_SCALER_H
+
+#include <glib.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+	/* gdk-pixbuf GDK_INTERP_BILINEAR */
+	SCALER_FILTER_BILINEAR,
+	/* Area averaging when shrinking, linear interpolation when enlarging */
+	SCALER_FILTER_AREA
+} ScalerFilter;
+
+typedef enum
+{
+	/* Best kernel supported by the running CPU */
+	SCALER_KERNEL_AUTO,
+	/* Portable reference implementation */
+	SCALER_KERNEL_SCALAR,
+	SCALER_KERNEL_SSE2,
+	SCALER_KERNEL_AVX2
+} ScalerKernel;
+
+gboolean     scaler_filter_from_string (const gchar*  name,
+                                        ScalerFilter* filter);
+const gchar* scaler_kernel_to_string   (ScalerKernel  kernel);
+/* Best kernel of the running CPU, every kernel below it is supported too */
+ScalerKernel scaler_detect_kernel      (void);
+
+/* All kernels give exactly the same pixels */
+GdkPixbuf*   scaler_scale_pixbuf       (GdkPixbuf*    source,
+                                        gint          width,
+                                        gint          height,
+                                        ScalerFilter  filter,
+                                        ScalerKernel  kernel);
+
+G_END_DECLS
+
+#endif